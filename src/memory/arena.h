@@ -0,0 +1,23 @@
+#pragma once
+
+#include "memory/utils.h"
+
+#include <cstdint>
+
+extern "C" {
+// a bump allocator: blocks are allocated at the top of a mapped pool and freed all at once
+struct arena {
+    mem_pool pool;
+    uint64_t top; // offset of the first free byte
+};
+
+// memory operations
+int64_t arena_init(arena* parena, uint64_t capacity, uint64_t flags);
+int64_t arena_deinit(arena* parena);
+
+void* arena_allocate(arena* parena, uint64_t size);
+void* arena_allocate_aligned(arena* parena, uint64_t size, uint64_t alignment);
+uint64_t arena_mark(const arena* parena);
+int64_t arena_rewind(arena* parena, uint64_t mark);
+void arena_reset(arena* parena);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "memory/utils.h"
+
+#include <cstdint>
+
+extern "C" {
+// blocks of power of 2 sizes split from (and joined back into) a mapped pool of power of 2 size
+struct buddy {
+    mem_pool pool;      // memory followed by the bitmaps of free and of split blocks
+    uint64_t order;     // memory size is 2^order
+    uint64_t orders;    // bit k is set if there are free blocks of order k
+    uint64_t* pfree;    // bitmap of free blocks (one bit per node of the tree of blocks)
+    uint64_t* psplit;   // bitmap of split blocks
+    void* heads[64];    // first free block of each order
+};
+
+// memory operations
+int64_t buddy_init(buddy* pbuddy, uint64_t memory_size);
+int64_t buddy_deinit(buddy* pbuddy);
+
+void* buddy_allocate(buddy* pbuddy, uint64_t size);
+int64_t buddy_deallocate(buddy* pbuddy, void* ptr);
+
+// node functions
+uint64_t _buddy_node(uint64_t max_order, uint64_t order, uint64_t offset);
+uint64_t _buddy_test(const uint64_t* pbits, uint64_t node);
+void _buddy_set(uint64_t* pbits, uint64_t node);
+void _buddy_clear(uint64_t* pbits, uint64_t node);
+
+// free list functions
+void _buddy_push(buddy* pbuddy, uint64_t order, void* pblock);
+void _buddy_remove(buddy* pbuddy, uint64_t order, void* pblock);
+}
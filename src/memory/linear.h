@@ -1,37 +1,153 @@
 #pragma once
 
+#include "memory/utils.h"
+
 #include <cstdint>
 
 extern "C" {
+// size class bins: MAVH they were built for, bitmap, 64 heads, free bytes, least free bytes seen,
+// # of free blocks of each size class, placement policy and where the next fit search starts
+constexpr uint64_t LINEAR_BINS = 198;
+
 extern uint64_t _linear_mavh;
+extern uint64_t _linear_bins[LINEAR_BINS];
+extern uint64_t _linear_options;
+extern uint64_t _linear_lock;
+
+// options of linear_init_with_options
+constexpr uint64_t LINEAR_CONCURRENT = 0x1; // allocate/deallocate can be called by many threads
+constexpr uint64_t LINEAR_MMAP = 0x2;       // pool in a mapping of its own (unmapped by deinit)
+constexpr uint64_t LINEAR_HUGEPAGES = 0x4;  // with LINEAR_MMAP: advise transparent huge pages
+constexpr uint64_t LINEAR_HUGETLB = 0x8;    // with LINEAR_MMAP: huge pages of hugetlbfs
+constexpr uint64_t LINEAR_POISON = 0x10;    // fill the pool with '-' (touches all its pages)
+constexpr uint64_t LINEAR_DEFERRED = 0x20;  // park freed small blocks, coalesce them later
+// placement policy (the default takes the first block of the smallest size class that fits)
+constexpr uint64_t LINEAR_FIRST_FIT = 0x40; // the block of lowest address that fits
+constexpr uint64_t LINEAR_NEXT_FIT = 0x80;  // the first block that fits from the previous one
+constexpr uint64_t LINEAR_BEST_FIT = 0xc0;  // the smallest block that fits
 
 // memory operations
 int64_t linear_init(uint64_t memory_size);
+int64_t linear_init_with_options(uint64_t memory_size, uint64_t options);
 void linear_deinit();
 
 void* linear_allocate(uint64_t size);
 void* linear_allocate_filled(uint64_t size, char c);
+void* linear_allocate_aligned(uint64_t size, uint64_t alignment);
+int64_t linear_allocate_batch(const uint64_t* sizes, uint64_t n, void** ptrs);
+// with LINEAR_CONCURRENT a block is looked up in MAV like without it: -1 is returned for a pointer
+// that is not a used block, a size before it that does not match the block or a block already in
+// the magazine of the thread
 int64_t linear_deallocate(const void* ptr);
+int64_t linear_deallocate_batch(void* const* ptrs, uint64_t n);
+void* linear_reallocate(void* ptr, uint64_t size);
+int64_t linear_thread_flush();
+
+// statistics of a pool (see linear_stats)
+struct linear_statistics {
+    uint64_t memory_size;        // bytes of allocatable memory
+    uint64_t mav_size;           // bytes of MAV
+    uint64_t used_bytes;         // in used blocks
+    uint64_t free_bytes;         // in free blocks
+    uint64_t peak_used_bytes;    // since the pool was initialized
+    uint64_t largest_free_block; // bytes of the largest free block (see linear_stats)
+    uint64_t fragmentation;      // free bytes out of the largest free block (parts per million)
+    uint64_t used_blocks;        // # of used MSHs
+    uint64_t free_blocks;        // # of free MSHs
+    // # of free blocks of each size class (size in [2^k, 2^(k + 1)))
+    uint64_t free_blocks_by_class[64];
+};
+
+// the blocks parked in the quick-lists (LINEAR_DEFERRED) or in the magazines (LINEAR_CONCURRENT)
+// are counted as used; largest_free_block is exact unless the largest block of the highest size
+// class was allocated and the class has more than 16 blocks, then it is the largest of 16 of them
+// (more than half of the exact one)
+int64_t linear_stats(linear_statistics* stats);
+// give the memory the pool does not use back to the OS (halves MAV, shrinks the pool and discards
+// the pages inside big free blocks)
+int64_t linear_trim();
+
+// an allocator with a pool and MAV of its own (the pool is mapped: it grows in place)
+struct linear_arena {
+    mem_pool pool;
+    uint64_t mavh;
+    uint64_t bins[LINEAR_BINS];
+};
+
+// arena operations (an arena must not be used by many threads at once)
+int64_t linear_arena_create(linear_arena* arena, uint64_t memory_size);
+void* linear_arena_allocate(linear_arena* arena, uint64_t size);
+int64_t linear_arena_deallocate(linear_arena* arena, const void* ptr);
+void* linear_arena_reallocate(linear_arena* arena, void* ptr, uint64_t size);
+void* linear_arena_allocate_aligned(linear_arena* arena, uint64_t size, uint64_t alignment);
+int64_t linear_arena_allocate_batch(linear_arena* arena,
+        const uint64_t* sizes,
+        uint64_t n,
+        void** ptrs);
+int64_t linear_arena_deallocate_batch(linear_arena* arena, void* const* ptrs, uint64_t n);
+int64_t linear_arena_stats(linear_arena* arena, linear_statistics* stats);
+int64_t linear_arena_trim(linear_arena* arena);
+int64_t linear_arena_destroy(linear_arena* arena);
 
 // MAVH functions
 uint64_t _linear_get_mav_size(uint64_t mavh);
 uint64_t _linear_get_memory_size(uint64_t mavh);
-uint64_t _linear_get_number_of_free_segment_headers(uint64_t mavh);
-uint64_t _linear_get_number_of_used_segment_headers(uint64_t mavh);
+uint64_t _linear_get_number_of_free_segment_headers(uint64_t mavh, const uint8_t* pmem);
+uint64_t _linear_get_number_of_used_segment_headers(uint64_t mavh, const uint8_t* pmem);
+uint64_t _linear_get_msh_unit(uint64_t mavh);
 uint64_t _linear_set_mavh(uint64_t mem_sz, uint64_t mav_sz, uint64_t num_free, uint64_t num_used);
 
-// memory segment header functions
-uint64_t _linear_set_msh(uint64_t offset, uint64_t size);
-uint64_t _linear_reduce_free_space(uint64_t msh, uint64_t size);
-uint64_t _linear_block_offset(uint64_t msh);
-uint64_t _linear_block_size(uint64_t msh);
+// memory segment header functions (offsets and sizes are in units that depend on the memory size)
+uint64_t _linear_set_msh(uint64_t offset, uint64_t size, uint64_t mavh);
+uint64_t _linear_reduce_free_space(uint64_t msh, uint64_t size, uint64_t mavh);
+uint64_t _linear_block_offset(uint64_t msh, uint64_t mavh);
+uint64_t _linear_block_size(uint64_t msh, uint64_t mavh);
 uint64_t* _linear_find_free_msh(uint64_t mavh, const uint8_t* pmem, uint64_t alloc_sz);
+uint64_t* _linear_find_free_msh_next_fit(uint64_t* pbins,
+        uint64_t mavh,
+        const uint8_t* pmem,
+        uint64_t alloc_sz);
 uint64_t* _linear_find_used_msh(uint64_t mavh, const uint8_t* pmem, const uint8_t* ptr);
 uint64_t _linear_find_index_new_free_msh(uint64_t mavh, const uint8_t* pmem, uint64_t offset);
 uint64_t* _linear_find_position_new_used_msh(uint64_t mavh, const uint8_t* pmem, uint64_t offset);
 uint64_t _linear_expand_mav_if_necessary(uint64_t mavh, const uint8_t* pmem);
+uint64_t _linear_expand_mav_in(uint64_t mavh, const uint8_t* pmem, mem_pool* ppool);
+uint64_t _linear_shrink_mav(uint64_t mavh, uint8_t* pmem);
 uint64_t _linear_insert_free_msh(uint64_t mavh, uint8_t* pmem, uint64_t msh);
+uint64_t _linear_put_free_msh(uint64_t mavh, uint8_t* pmem, uint64_t msh);
 uint64_t _linear_insert_used_msh(uint64_t mavh, uint8_t* pmem, uint64_t msh);
 uint64_t _linear_remove_free_msh(uint64_t mavh, uint8_t* pmem, uint64_t* pmsh);
 uint64_t _linear_remove_used_msh(uint64_t mavh, uint8_t* pmem, uint64_t* pmsh);
+uint64_t* _linear_lower_bound_free_msh(uint64_t mavh, const uint8_t* pmem, uint64_t offset);
+uint64_t* _linear_lower_bound_used_msh(uint64_t mavh, const uint8_t* pmem, uint64_t offset);
+uint64_t* _linear_find_free_msh_by_offset(uint64_t mavh, const uint8_t* pmem, uint64_t offset);
+uint64_t* _linear_free_msh_at(uint64_t mavh, const uint8_t* pmem, uint64_t idx);
+uint64_t* _linear_used_msh_at(uint64_t mavh, const uint8_t* pmem, uint64_t idx);
+
+// MAV pages functions
+void _linear_mav_init(uint64_t mavh, uint8_t* pmem);
+
+// concurrency functions
+void _linear_lock_acquire(uint64_t* plock);
+void _linear_lock_release(uint64_t* plock);
+
+// size class bins functions
+uint64_t _linear_size_class(uint64_t size);
+void _linear_bins_build(uint64_t* pbins, uint64_t mavh, uint8_t* pmem);
+void _linear_bins_sync(uint64_t* pbins, uint64_t mavh, uint8_t* pmem);
+void _linear_bins_insert(uint64_t* pbins, uint8_t* pmem, uint64_t msh);
+void _linear_bins_remove(uint64_t* pbins, uint8_t* pmem, uint64_t msh);
+uint64_t* _linear_bins_find_free_msh(const uint64_t* pbins,
+        uint64_t mavh,
+        const uint8_t* pmem,
+        uint64_t alloc_sz);
+uint64_t* _linear_bins_find_best_msh(const uint64_t* pbins,
+        uint64_t mavh,
+        const uint8_t* pmem,
+        uint64_t alloc_sz);
+uint64_t* _linear_place_free_msh(uint64_t* pbins,
+        uint64_t mavh,
+        const uint8_t* pmem,
+        uint64_t alloc_sz);
+uint64_t _linear_bins_insert_free_msh(uint64_t* pbins, uint64_t mavh, uint8_t* pmem, uint64_t msh);
 }
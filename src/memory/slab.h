@@ -0,0 +1,23 @@
+#pragma once
+
+#include "memory/utils.h"
+
+#include <cstdint>
+
+extern "C" {
+// slots of the same size carved from a mapped pool (the free slots are linked through their first
+// 8 bytes, the slots have no header)
+struct slab {
+    mem_pool pool;
+    uint64_t slot_sz;
+    void* free; // last freed slot (nullptr if none)
+    uint64_t top; // offset of the first slot never used
+};
+
+// memory operations
+int64_t slab_init(slab* pslab, uint64_t slot_size, uint64_t capacity);
+int64_t slab_deinit(slab* pslab);
+
+void* slab_allocate(slab* pslab);
+int64_t slab_deallocate(slab* pslab, void* ptr);
+}
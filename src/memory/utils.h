@@ -5,6 +5,33 @@
 extern "C" {
 extern uint8_t* _mem_pbase;
 extern uint64_t _mem_size;
+extern uint64_t _mem_capacity;
+extern uint64_t _mem_flags;
+
+// flags of mapped pools
+constexpr uint64_t MEM_MMAP = 0x1;      // the pool is a mapping of its own (set by the functions)
+constexpr uint64_t MEM_HUGEPAGES = 0x2; // advise transparent huge pages (MADV_HUGEPAGE)
+constexpr uint64_t MEM_HUGETLB = 0x4;   // map huge pages of hugetlbfs (MAP_HUGETLB)
+
+// features of the processor used by mem_fill_n and mem_copy_n
+constexpr uint64_t MEM_FEATURE_SVE = 0x1; // scalable vectors (HWCAP_SVE)
+constexpr uint64_t MEM_FEATURE_ZVA = 0x2; // dc zva zeroes blocks of memory (DCZID_EL0)
+
+// a pool (_mem_pbase, _mem_size, _mem_capacity, _mem_flags is the global one, others are mapped)
+struct mem_pool {
+    uint8_t* pbase;
+    uint64_t size;     // accessible bytes
+    uint64_t capacity; // reserved address space
+    uint64_t flags;
+};
+
+int64_t mem_init_mapped(uint64_t capacity, uint64_t flags);
+int64_t mem_pool_map(mem_pool* ppool, uint64_t capacity, uint64_t flags);
+int64_t mem_pool_reserve(mem_pool* ppool, uint64_t size);
+void* mem_pool_grow_to(mem_pool* ppool, uint64_t offset, uint64_t top, uint64_t* ptop);
+int64_t mem_pool_release(mem_pool* ppool, uint64_t size);
+int64_t mem_pool_discard(mem_pool* ppool, uint64_t offset, uint64_t size);
+int64_t mem_pool_unmap(mem_pool* ppool);
 
 uint64_t mem_next_mult_power_of_2(uint64_t value, uint64_t power);
 uint64_t mem_power_of_2_ceiling(uint64_t value);
@@ -16,4 +43,6 @@ void mem_copy(const void* src_begin, const void* src_end, void* dst_end);
 void mem_copy_n(const void* src_begin, uint64_t n, void* dst_end);
 void mem_copy_backward(const void* src_begin, const void* src_end, void* dst_end);
 void mem_copy_n_backward(const void* src_begin, uint64_t n, void* dst_end);
+uint64_t mem_features();
+uint64_t mem_set_features(uint64_t features);
 }
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "sorting/quick.h"
+
+#include <cstdint>
+
+extern "C" {
+void _block_quick_sort(uint64_t* begin, uint64_t* end, pivot_f pivot);
+uint64_t* _block_partition(uint64_t* begin, uint64_t* end, uint64_t* pivot);
+}
@@ -0,0 +1,189 @@
+.global _block_quick_sort
+.global _block_partition
+
+.equ    INSERTION_SORT_MAX_SZ, 16      // partitions of up to 16 elements are insertion sorted
+.equ    BLOCK_SZ, 64                   // elements per block (offsets fit in a byte)
+.equ    BLOCK_PARTITION_STACK, 16 + 2 * BLOCK_SZ
+
+.text
+/// sort an array of ints (inplace) with BlockQuicksort: quick sort with a block partition that does
+/// not branch on the comparisons and insertion sort for small partitions
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @param x2   pivot function
+/// @return NONE
+_block_quick_sort:
+    stp     x29, x30, [sp, -48]!
+    stp     x19, x20, [sp, 16]
+    stp     x21, x22, [sp, 32]
+
+    mov     x19, x0                 // x19 - begin of array
+    mov     x20, x1                 // x20 - end of array
+    mov     x21, x2                 // x21 - pivot function
+
+    ._block_quick_sort.loop:
+        sub     x10, x20, x19
+        cmp     x10, INSERTION_SORT_MAX_SZ * 8
+        b.gt    ._block_quick_sort.partition
+
+        mov     x0, x19
+        mov     x1, x20
+        bl      _insertion_sort
+        b       ._block_quick_sort.return
+
+        ._block_quick_sort.partition:
+        mov     x0, x19
+        mov     x1, x20
+        blr     x21                 // x0 - pointer to pivot
+        mov     x2, x0
+        mov     x0, x19
+        mov     x1, x20
+        bl      _block_partition    // x0 - final position of the pivot
+
+        // the parts are [x19, x0[ and [x0 + 8, x20[
+        sub     x10, x0, x19
+        sub     x11, x20, x0
+        sub     x11, x11, 8
+        cmp     x10, x11
+        b.hi    ._block_quick_sort.left_is_bigger
+
+        add     x22, x0, 8
+        mov     x1, x0
+        mov     x0, x19
+        mov     x2, x21
+        bl      _block_quick_sort
+        mov     x19, x22
+        b       ._block_quick_sort.loop
+
+        ._block_quick_sort.left_is_bigger:
+        mov     x22, x0
+        add     x0, x0, 8
+        mov     x1, x20
+        mov     x2, x21
+        bl      _block_quick_sort
+        mov     x20, x22
+        b       ._block_quick_sort.loop
+
+    ._block_quick_sort.return:
+    ldp     x19, x20, [sp, 16]
+    ldp     x21, x22, [sp, 32]
+    ldp     x29, x30, [sp], 48
+    ret
+
+/// partition an array around the pivot in blocks of BLOCK_SZ elements (Edelkamp and Weiss): the
+/// offsets of the elements that are in the wrong side are stored without branches (the store is
+/// always made and the count is incremented by the result of the comparison) and then they are
+/// swapped in bulk; the elements that are left (less than 2 blocks) are partitioned by scanning
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @param x2   pointer to pivot
+/// @return x0  final position of the pivot (the elements before are <= and after are >= to it)
+_block_partition:
+    stp     x29, x30, [sp, -BLOCK_PARTITION_STACK]!
+
+    ldr     x3, [x2]                // x3 - pivot value
+    ldr     x4, [x0]
+    str     x4, [x2]
+    str     x3, [x0]                // the pivot goes to the beginning
+
+    add     x4, x0, 8               // x4 - left (the elements before it are <= pivot)
+    mov     x5, x1                  // x5 - right (the elements from it are >= pivot)
+    add     x6, sp, 16              // x6 - offsets of the elements >= pivot in the left block
+    add     x7, x6, BLOCK_SZ        // x7 - offsets of the elements <= pivot in the right block
+    mov     x8, 0                   // x8 - number of offsets in the left block
+    mov     x9, 0                   // x9 - number of offsets in the right block
+    mov     x10, 0                  // x10 - first offset not swapped in the left block
+    mov     x11, 0                  // x11 - first offset not swapped in the right block
+
+    ._block_partition.block_loop:
+        sub     x12, x5, x4
+        cmp     x12, 2 * BLOCK_SZ * 8
+        b.lt    ._block_partition.tail  // the blocks would overlap
+
+        cbnz    x8, ._block_partition.right_block
+        mov     x10, 0
+        mov     x13, 0
+        ._block_partition.left_block_loop:
+            ldr     x14, [x4, x13, lsl 3]
+            cmp     x14, x3
+            strb    w13, [x6, x8]
+            cinc    x8, x8, ge
+            add     x13, x13, 1
+            cmp     x13, BLOCK_SZ
+            b.lo    ._block_partition.left_block_loop
+
+        ._block_partition.right_block:
+        cbnz    x9, ._block_partition.swap
+        mov     x11, 0
+        mov     x13, 0
+        mov     x15, x5
+        ._block_partition.right_block_loop:
+            ldr     x14, [x15, -8]!
+            cmp     x14, x3
+            strb    w13, [x7, x9]
+            cinc    x9, x9, le
+            add     x13, x13, 1
+            cmp     x13, BLOCK_SZ
+            b.lo    ._block_partition.right_block_loop
+
+        ._block_partition.swap:
+        cmp     x8, x9
+        csel    x12, x8, x9, lo     // x12 - number of swaps
+        add     x13, x6, x10        // x13 - next offset in the left block
+        add     x14, x7, x11        // x14 - next offset in the right block
+        add     x10, x10, x12
+        add     x11, x11, x12
+        sub     x8, x8, x12
+        sub     x9, x9, x12
+        ._block_partition.swap_loop:
+            cbz     x12, ._block_partition.swap_end
+            ldrb    w15, [x13], 1
+            ldrb    w16, [x14], 1
+            add     x15, x4, x15, lsl 3     // the left element
+            sub     x16, x5, x16, lsl 3     // one after the right element
+            ldr     x1, [x15]
+            ldr     x2, [x16, -8]
+            str     x2, [x15]
+            str     x1, [x16, -8]
+            sub     x12, x12, 1
+            b       ._block_partition.swap_loop
+        ._block_partition.swap_end:
+
+        add     x12, x4, BLOCK_SZ * 8
+        cmp     x8, 0
+        csel    x4, x12, x4, eq     // the left block is done
+        sub     x12, x5, BLOCK_SZ * 8
+        cmp     x9, 0
+        csel    x5, x12, x5, eq     // the right block is done
+        b       ._block_partition.block_loop
+
+    ._block_partition.tail:
+        ._block_partition.tail_left:
+            cmp     x4, x5
+            b.hs    ._block_partition.tail_end
+            ldr     x12, [x4]
+            cmp     x12, x3
+            b.gt    ._block_partition.tail_right
+            add     x4, x4, 8
+            b       ._block_partition.tail_left
+        ._block_partition.tail_right:
+            ldr     x13, [x5, -8]
+            cmp     x13, x3
+            b.le    ._block_partition.tail_swap
+            sub     x5, x5, 8
+            cmp     x5, x4
+            b.hi    ._block_partition.tail_right
+            b       ._block_partition.tail_end
+        ._block_partition.tail_swap:     // x4 < x5 - 8: [x4] > pivot and [x5 - 8] <= pivot
+            str     x13, [x4], 8
+            str     x12, [x5, -8]!
+            b       ._block_partition.tail_left
+    ._block_partition.tail_end:
+
+    ldr     x12, [x4, -8]!          // the last element <= pivot goes to the beginning
+    str     x12, [x0]
+    str     x3, [x4]
+    mov     x0, x4
+
+    ldp     x29, x30, [sp], BLOCK_PARTITION_STACK
+    ret
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+extern "C" {
+void _heap_sort(uint64_t *begin, uint64_t *end);
+}
@@ -0,0 +1,82 @@
+.global _heap_sort
+
+.text
+
+/// sort an array of ints (inplace) with heap sort algorithm (O(n log n) even in the worst case)
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @return NONE
+_heap_sort:
+    stp     x29, x30, [sp, -48]!
+    stp     x19, x20, [sp, 16]
+    stp     x21, x22, [sp, 32]
+
+    mov     x19, x0                 // x19 points to begin of array
+    sub     x20, x1, x0
+    lsr     x20, x20, 3             // x20 is the # of elements in the heap
+
+    // make a max heap: sift down every element that has children, the last first
+    lsr     x21, x20, 1
+    ._heap_sort.heapify_loop:
+        cbz     x21, ._heap_sort.heapify_loop_end
+        sub     x21, x21, 1
+        mov     x0, x19
+        mov     x1, x21
+        mov     x2, x20
+        bl      _heap_sift_down
+        b       ._heap_sort.heapify_loop
+    ._heap_sort.heapify_loop_end:
+
+    // move the biggest to the end of the heap and sift down the one that took its place
+    ._heap_sort.sort_loop:
+        cmp     x20, 1
+        b.ls    ._heap_sort.sort_loop_end
+        sub     x20, x20, 1
+        ldr     x8, [x19]
+        ldr     x9, [x19, x20, lsl 3]
+        str     x9, [x19]
+        str     x8, [x19, x20, lsl 3]
+        mov     x0, x19
+        mov     x1, xzr
+        mov     x2, x20
+        bl      _heap_sift_down
+        b       ._heap_sort.sort_loop
+    ._heap_sort.sort_loop_end:
+
+    ldp     x21, x22, [sp, 32]
+    ldp     x19, x20, [sp, 16]
+    ldp     x29, x30, [sp], 48
+
+    ret
+
+/// move an element of a max heap down until its children are not bigger
+/// @param x0   begin of heap
+/// @param x1   index of the element
+/// @param x2   # of elements in the heap
+/// @return NONE
+_heap_sift_down:
+    ldr     x10, [x0, x1, lsl 3]    // x10 is the value that goes down
+    ._heap_sift_down.loop:
+        lsl     x11, x1, 1
+        add     x11, x11, 1             // x11 is the index of the left child
+        cmp     x11, x2
+        b.hs    ._heap_sift_down.loop_end
+        ldr     x12, [x0, x11, lsl 3]
+        add     x13, x11, 1             // x13 is the index of the right child
+        cmp     x13, x2
+        b.hs    ._heap_sift_down.bigger_child
+        ldr     x14, [x0, x13, lsl 3]
+        cmp     x14, x12
+        b.le    ._heap_sift_down.bigger_child
+        mov     x11, x13
+        mov     x12, x14
+        ._heap_sift_down.bigger_child:  // x11 and x12 are the index and value of the bigger child
+        cmp     x12, x10
+        b.le    ._heap_sift_down.loop_end
+        str     x12, [x0, x1, lsl 3]
+        mov     x1, x11
+        b       ._heap_sift_down.loop
+    ._heap_sift_down.loop_end:
+    str     x10, [x0, x1, lsl 3]
+
+    ret
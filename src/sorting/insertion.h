@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+extern "C" {
+void _insertion_sort(uint64_t *begin, uint64_t *end);
+}
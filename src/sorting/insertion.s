@@ -0,0 +1,30 @@
+.global _insertion_sort
+
+.text
+
+/// sort an array of ints (inplace) with insertion sort algorithm (fast for small arrays)
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @return NONE
+_insertion_sort:
+    add     x9, x0, 8               // x9 points to the element to insert
+    ._insertion_sort.outer_loop:
+        cmp     x9, x1
+        b.hs    ._insertion_sort.outer_loop_end
+        ldr     x10, [x9]               // x10 is the value to insert
+        mov     x11, x9                 // x11 is where it goes
+        ._insertion_sort.inner_loop:
+            cmp     x11, x0
+            b.eq    ._insertion_sort.inner_loop_end
+            ldr     x12, [x11, -8]
+            cmp     x12, x10
+            b.le    ._insertion_sort.inner_loop_end
+            str     x12, [x11], -8          // move the bigger value one position right
+            b       ._insertion_sort.inner_loop
+        ._insertion_sort.inner_loop_end:
+        str     x10, [x11]
+        add     x9, x9, 8
+        b       ._insertion_sort.outer_loop
+    ._insertion_sort.outer_loop_end:
+
+    ret
@@ -5,10 +5,24 @@
 extern "C" {
 typedef uint64_t* (*pivot_f)(uint64_t* begin, uint64_t* end);
 void _quick_sort(uint64_t* begin, uint64_t* end, pivot_f pivot);
+void _intro_sort(uint64_t* begin, uint64_t* end, pivot_f pivot);
+void _quick_sort_three_way(uint64_t* begin, uint64_t* end, pivot_f pivot);
+
+// quick sort with the pivot strategy built in (no call to a pivot function per partition)
+typedef void (*sort_f)(uint64_t* begin, uint64_t* end);
+void _quick_sort_left(uint64_t* begin, uint64_t* end);
+void _quick_sort_right(uint64_t* begin, uint64_t* end);
+void _quick_sort_middle(uint64_t* begin, uint64_t* end);
+void _quick_sort_random(uint64_t* begin, uint64_t* end);
+void _quick_sort_semi_random(uint64_t* begin, uint64_t* end);
+void _quick_sort_median_of_three(uint64_t* begin, uint64_t* end);
+void _quick_sort_ninther(uint64_t* begin, uint64_t* end);
 
 uint64_t* _left_pivot(uint64_t* begin, uint64_t* end);
 uint64_t* _right_pivot(uint64_t* begin, uint64_t* end);
 uint64_t* _middle_pivot(uint64_t* begin, uint64_t* end);
 uint64_t* _random_pivot(uint64_t* begin, uint64_t* end);
 uint64_t* _semi_random_pivot(uint64_t* begin, uint64_t* end);
+uint64_t* _median_of_three_pivot(uint64_t* begin, uint64_t* end);
+uint64_t* _ninther_pivot(uint64_t* begin, uint64_t* end);
 }
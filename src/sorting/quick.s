@@ -1,9 +1,102 @@
 .global _quick_sort
+.global _intro_sort
+.global _quick_sort_three_way
 .global _left_pivot
 .global _right_pivot
 .global _middle_pivot
 .global _random_pivot
 .global _semi_random_pivot
+.global _median_of_three_pivot
+.global _ninther_pivot
+.global _quick_sort_left
+.global _quick_sort_right
+.global _quick_sort_middle
+.global _quick_sort_random
+.global _quick_sort_semi_random
+.global _quick_sort_median_of_three
+.global _quick_sort_ninther
+
+.equ    INSERTION_SORT_MAX_SZ, 16      // partitions of up to 16 elements are insertion sorted
+.equ    NINTHER_MIN_SZ, 128            // smaller partitions use the median of three for the ninther
+
+// the pivot strategies: put a pointer to the pivot in [x0, x1[ in x0 (dirty x0 - x18)
+.macro left_pivot
+.endm
+
+.macro right_pivot
+    sub     x0, x1, 16      // 1 before last to avoid stack overflow
+.endm
+
+.macro middle_pivot
+    sub     x10, x1, x0     // distance
+    sub     x10, x10, 8     // to avoid giving the right when only 2 are left and cause stack overflow
+    lsr     x10, x10, 4     // x10 = x10 / 2 / 8
+    lsl     x10, x10, 3     // x0 = x10 * 8 to assure alignment
+    add     x0, x0, x10
+.endm
+
+.macro random_pivot
+    bl      _random_pivot
+.endm
+
+.macro semi_random_pivot
+    bl      _semi_random_pivot
+.endm
+
+// put in \b the pointer to the median of the values pointed by \a, \b and \c (dirty \a, x12 - x16)
+.macro median_of_three a, b, c
+    ldr     x12, [\a]
+    ldr     x13, [\b]
+    ldr     x14, [\c]
+    cmp     x12, x13
+    csel    x15, \a, \b, gt     // x15 - pointer to max(a, b)
+    csel    x16, x12, x13, gt   // x16 - max(a, b)
+    csel    \a, \b, \a, gt     // \a - pointer to min(a, b)
+    csel    x12, x13, x12, gt   // x12 - min(a, b)
+    cmp     x16, x14
+    csel    \b, \c, x15, gt     // \b - pointer to min(max(a, b), c)
+    csel    x13, x14, x16, gt   // x13 - min(max(a, b), c)
+    cmp     x12, x13
+    csel    \b, \a, \b, gt     // \b - pointer to max(min(a, b), min(max(a, b), c))
+.endm
+
+// the median of the first, middle and (almost) last elements (never the last, like the right pivot)
+.macro median_of_three_pivot
+    mov     x9, x0              // x9 - first
+    sub     x11, x1, 16         // x11 - 1 before last
+    cmp     x11, x9
+    csel    x11, x9, x11, lo    // a single element
+    middle_pivot                // x0 - middle
+    median_of_three x9, x0, x11
+.endm
+
+// the median of the medians of three groups of three elements spread over the array (Tukey's
+// ninther), the median of three for partitions with less than NINTHER_MIN_SZ elements
+.macro ninther_pivot
+    sub     x10, x1, x0
+    cmp     x10, NINTHER_MIN_SZ * 8
+    b.hs    1f
+    median_of_three_pivot
+    b       2f
+1:
+    lsr     x10, x10, 6
+    lsl     x10, x10, 3         // x10 - an eighth of the array (aligned to 8 bytes)
+    add     x2, x0, x10         // left group: first, first + 1/8, first + 2/8
+    add     x3, x2, x10
+    sub     x4, x1, 16          // right group: last - 2/8, last - 1/8, last (1 before last)
+    sub     x5, x4, x10
+    sub     x6, x5, x10
+    mov     x7, x0
+    median_of_three x7, x2, x3  // x2 - median of the left group
+    median_of_three x6, x5, x4  // x5 - median of the right group
+    mov     x9, x10
+    middle_pivot                // middle group: middle - 1/8, middle, middle + 1/8
+    sub     x3, x0, x9
+    add     x4, x0, x9
+    median_of_three x3, x0, x4  // x0 - median of the middle group
+    median_of_three x2, x0, x5
+2:
+.endm
 
 .text
 /// sort an array of ints (inplace) with bubble sort algorithm
@@ -52,6 +145,190 @@ _quick_sort:
     ._quick_sort.return:
     ret
 
+/// sort an array of ints (inplace) with introsort: quick sort down to a depth of 2 * log2(n), heap
+/// sort for partitions below it (the pivots were bad) and insertion sort for small partitions
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @param x2   pivot function
+/// @return NONE
+_intro_sort:
+    sub     x9, x1, x0
+    lsr     x9, x9, 3               // # of elements
+    cmp     x9, 1
+    b.ls    ._intro_sort.return     // at most 1 element
+
+    clz     x10, x9
+    mov     x11, 63
+    sub     x10, x11, x10           // log2(n) rounded down
+    lsl     x3, x10, 1              // depth limit
+    b       _intro_sort_loop
+
+    ._intro_sort.return:
+    ret
+
+/// sort an array of ints (inplace) with introsort partitioning it at most x3 times in a row
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @param x2   pivot function
+/// @param x3   depth limit
+/// @return NONE
+_intro_sort_loop:
+    stp     x29, x30, [sp, -64]!
+    stp     x19, x20, [sp, 16]
+    stp     x21, x22, [sp, 32]
+    stp     x23, x24, [sp, 48]
+
+    mov     x19, x0                 // x19 - begin of array
+    mov     x20, x1                 // x20 - end of array (const)
+    mov     x21, x2                 // x21 - pivot function
+    mov     x22, x3                 // x22 - depth limit
+
+    ._intro_sort_loop.loop:
+        sub     x9, x20, x19
+        cmp     x9, INSERTION_SORT_MAX_SZ * 8
+        b.le    ._intro_sort_loop.small
+        cbz     x22, ._intro_sort_loop.too_deep
+        sub     x22, x22, 1
+
+        mov     x0, x19
+        mov     x1, x20
+        mov     x2, x21
+        bl      _hoare_partition
+        mov     x23, x0             // save pivot position
+
+        // the left part is sorted recursively and the right part by this loop
+        mov     x0, x19
+        add     x1, x23, 8
+        mov     x2, x21
+        mov     x3, x22
+        bl      _intro_sort_loop
+
+        add     x19, x23, 8
+        b       ._intro_sort_loop.loop
+
+    ._intro_sort_loop.too_deep:
+    mov     x0, x19
+    mov     x1, x20
+    bl      _heap_sort
+    b       ._intro_sort_loop.return
+
+    ._intro_sort_loop.small:
+    mov     x0, x19
+    mov     x1, x20
+    bl      _insertion_sort
+
+    ._intro_sort_loop.return:
+    ldp     x19, x20, [sp, 16]
+    ldp     x21, x22, [sp, 32]
+    ldp     x23, x24, [sp, 48]
+    ldp     x29, x30, [sp], 64
+    ret
+
+/// sort an array of ints (inplace) with quick sort partitioning in three parts: less than, equal to
+/// and greater than the pivot (the equal ones are done, so many duplicates take few partitions)
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @param x2   pivot function
+/// @return NONE
+_quick_sort_three_way:
+    stp     x29, x30, [sp, -48]!
+    stp     x19, x20, [sp, 16]
+    stp     x21, x22, [sp, 32]
+
+    mov     x19, x0                 // x19 - begin of array
+    mov     x20, x1                 // x20 - end of array
+    mov     x21, x2                 // x21 - pivot function
+
+    ._quick_sort_three_way.loop:
+        add     x10, x19, 8
+        cmp     x10, x20
+        b.ge    ._quick_sort_three_way.return   // at most 1 element
+
+        mov     x0, x19
+        mov     x1, x20
+        mov     x2, x21
+        bl      _three_way_partition    // [x0, x1[ are equal to the pivot
+
+        // the smaller part is sorted recursively and the bigger one by this loop (the stack
+        // grows at most log2(n) frames)
+        sub     x9, x0, x19
+        sub     x10, x20, x1
+        cmp     x9, x10
+        b.hi    ._quick_sort_three_way.left_is_bigger
+
+        mov     x22, x1
+        mov     x1, x0
+        mov     x0, x19
+        mov     x2, x21
+        bl      _quick_sort_three_way
+        mov     x19, x22
+        b       ._quick_sort_three_way.loop
+
+        ._quick_sort_three_way.left_is_bigger:
+        mov     x22, x0
+        mov     x0, x1
+        mov     x1, x20
+        mov     x2, x21
+        bl      _quick_sort_three_way
+        mov     x20, x22
+        b       ._quick_sort_three_way.loop
+
+    ._quick_sort_three_way.return:
+    ldp     x19, x20, [sp, 16]
+    ldp     x21, x22, [sp, 32]
+    ldp     x29, x30, [sp], 48
+    ret
+
+/// partition an array in three parts (Dijkstra's dutch national flag): less than, equal to and
+/// greater than the pivot
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @param x2   pivot function
+/// @return x0  begin of the elements equal to the pivot
+/// @return x1  end of the elements equal to the pivot
+_three_way_partition:
+    stp     x29, x30, [sp, -32]!
+    stp     x19, x20, [sp, 16]
+
+    mov     x19, x0
+    mov     x20, x1
+
+    blr     x2                      // get the pivot in [x0, x1[
+    ldr     x11, [x0]               // pivot value (const)
+
+    mov     x9, x19                 // x9 - end of the less than part
+    mov     x10, x19                // x10 - next element to classify
+                                    // x20 - begin of the greater than part
+    ._three_way_partition.loop:
+        cmp     x10, x20
+        b.hs    ._three_way_partition.loop_end
+        ldr     x12, [x10]
+        cmp     x12, x11
+        b.lt    ._three_way_partition.less
+        b.gt    ._three_way_partition.greater
+        add     x10, x10, 8         // equal: it stays
+        b       ._three_way_partition.loop
+
+        ._three_way_partition.less:
+        ldr     x13, [x9]
+        str     x12, [x9], 8
+        str     x13, [x10], 8
+        b       ._three_way_partition.loop
+
+        ._three_way_partition.greater:
+        ldr     x13, [x20, -8]!
+        str     x12, [x20]
+        str     x13, [x10]
+        b       ._three_way_partition.loop
+    ._three_way_partition.loop_end:
+
+    mov     x0, x9
+    mov     x1, x20
+
+    ldp     x19, x20, [sp, 16]
+    ldp     x29, x30, [sp], 32
+    ret
+
 /// sort an array of ints (inplace) with bubble sort algorithm
 /// @param x0   begin of array
 /// @param x1   end of array (one after last - open interval)
@@ -110,7 +387,7 @@ _left_pivot:
 /// @param x1   end of array (one after last - open interval)
 /// @return (x1 - 16) pointer to pivot
 _right_pivot:
-    sub     x0, x1, 16
+    right_pivot
     ret
 
 /// Return the pivot position in the middle of the sequence
@@ -118,12 +395,7 @@ _right_pivot:
 /// @param x1   end of array (one after last - open interval)
 /// @return x0  pointer to pivot
 _middle_pivot:
-    sub     x10, x1, x0     // distance
-    sub     x10, x10, 8     // to avoid giving the right when only 2 are left and cause stack overflow
-    lsr     x10, x10, 4     // x10 = x10 / 2 / 8
-    lsl     x10, x10, 3     // x0 = x10 * 8 to assure alignment
-    add     x0, x0, x10
-
+    middle_pivot
     ret
 
 /// Return the random pivot position
@@ -153,3 +425,102 @@ _semi_random_pivot:
 
     ldp     x29, x30, [sp], 16
     ret
+
+/// Return the pivot position of the median of the first, middle and (almost) last elements
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @return x0  pointer to pivot in the interval [x0, x1 - 8[ (x0 if there is a single element)
+_median_of_three_pivot:
+    median_of_three_pivot
+    ret
+
+/// Return the pivot position of the median of the medians of three groups of three elements at
+/// the beginning, middle and end of the array (median of three for less than 128 elements)
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @return x0  pointer to pivot in the interval [x0, x1 - 8[ (x0 if there is a single element)
+_ninther_pivot:
+    ninther_pivot
+    ret
+
+// quick sort with the pivot strategy \pivot and the Hoare partition inlined: no indirect call, the
+// swaps are made with the values already in registers, the smaller part is sorted recursively and
+// the bigger one by the loop (the stack grows at most log2(n) frames)
+.macro quick_sort_with_pivot name, pivot
+/// sort an array of ints (inplace) with quick sort and the \pivot strategy
+/// @param x0   begin of array
+/// @param x1   end of array (one after last - open interval)
+/// @return NONE
+\name:
+    stp     x29, x30, [sp, -48]!
+    stp     x19, x20, [sp, 16]
+    stp     x21, x22, [sp, 32]
+
+    mov     x19, x0                 // x19 - begin of array
+    mov     x20, x1                 // x20 - end of array
+
+    .\name\().loop:
+        add     x10, x19, 8
+        cmp     x10, x20
+        b.ge    .\name\().return     // at most 1 element
+
+        mov     x0, x19
+        mov     x1, x20
+        \pivot
+        ldr     x21, [x0]           // pivot value
+
+        sub     x9, x19, 8          // x9 - left iterator
+        mov     x10, x20            // x10 - right iterator
+        .\name\().partition:
+            .\name\().left_loop:
+                ldr     x11, [x9, 8]!
+                cmp     x11, x21
+                b.lt    .\name\().left_loop
+            .\name\().right_loop:
+                ldr     x12, [x10, -8]!
+                cmp     x12, x21
+                b.gt    .\name\().right_loop
+
+            cmp     x9, x10
+            b.ge    .\name\().partition_end
+            str     x12, [x9]
+            str     x11, [x10]
+            b       .\name\().partition
+        .\name\().partition_end:
+        add     x10, x10, 8         // the parts are [x19, x10[ and [x10, x20[
+
+        sub     x11, x10, x19
+        sub     x12, x20, x10
+        cmp     x11, x12
+        b.hi    .\name\().left_is_bigger
+
+        mov     x22, x10
+        mov     x0, x19
+        mov     x1, x10
+        bl      \name
+        mov     x19, x22
+        b       .\name\().loop
+
+        .\name\().left_is_bigger:
+        mov     x22, x10
+        mov     x0, x10
+        mov     x1, x20
+        bl      \name
+        mov     x20, x22
+        b       .\name\().loop
+
+    .\name\().return:
+    ldp     x19, x20, [sp, 16]
+    ldp     x21, x22, [sp, 32]
+    ldp     x29, x30, [sp], 48
+    ret
+.endm
+
+.text
+quick_sort_with_pivot _quick_sort_left, left_pivot
+quick_sort_with_pivot _quick_sort_right, right_pivot
+quick_sort_with_pivot _quick_sort_middle, middle_pivot
+quick_sort_with_pivot _quick_sort_random, random_pivot
+quick_sort_with_pivot _quick_sort_semi_random, semi_random_pivot
+quick_sort_with_pivot _quick_sort_median_of_three, median_of_three_pivot
+quick_sort_with_pivot _quick_sort_ninther, ninther_pivot
@@ -0,0 +1,65 @@
+#include "memory/arena.h"
+#include "memory/linear.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+// every iteration allocates NUM_BLOCKS blocks of state.range(0) bytes and frees them all
+constexpr uint64_t NUM_BLOCKS = 1000;
+
+void BM_Arena(benchmark::State& state) {
+    const uint64_t size = state.range(0);
+    arena scratch;
+    arena_init(&scratch, 0x1'0000'0000, 0);
+    for (auto _ : state) {
+        for (uint64_t i = 0; i < NUM_BLOCKS; ++i) {
+            benchmark::DoNotOptimize(arena_allocate(&scratch, size));
+        }
+        arena_reset(&scratch);
+    }
+    arena_deinit(&scratch);
+    state.SetItemsProcessed(state.iterations() * NUM_BLOCKS);
+}
+
+void BM_Linear(benchmark::State& state) {
+    const uint64_t size = state.range(0);
+    linear_arena pool;
+    linear_arena_create(&pool, 2 * NUM_BLOCKS * size);
+    std::vector<void*> ptrs(NUM_BLOCKS);
+    for (auto _ : state) {
+        for (auto& ptr : ptrs) {
+            ptr = linear_arena_allocate(&pool, size);
+            benchmark::DoNotOptimize(ptr);
+        }
+        for (auto ptr : ptrs) {
+            linear_arena_deallocate(&pool, ptr);
+        }
+    }
+    linear_arena_destroy(&pool);
+    state.SetItemsProcessed(state.iterations() * NUM_BLOCKS);
+}
+
+void BM_Malloc(benchmark::State& state) {
+    const uint64_t size = state.range(0);
+    std::vector<void*> ptrs(NUM_BLOCKS);
+    for (auto _ : state) {
+        for (auto& ptr : ptrs) {
+            ptr = std::malloc(size);
+            benchmark::DoNotOptimize(ptr);
+        }
+        for (auto ptr : ptrs) {
+            std::free(ptr);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_BLOCKS);
+}
+
+BENCHMARK(BM_Arena)->RangeMultiplier(8)->Range(16, 4096);
+BENCHMARK(BM_Linear)->RangeMultiplier(8)->Range(16, 4096);
+BENCHMARK(BM_Malloc)->RangeMultiplier(8)->Range(16, 4096);
+} // namespace
@@ -0,0 +1,135 @@
+#include "memory_test_utils.h"
+
+#include "memory/arena.h"
+#include "memory/utils.h"
+
+#include <errno.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace memory {
+namespace {
+
+class ArenaTest : public ::testing::Test {
+public:
+    void SetUp() override { ASSERT_EQ(arena_init(&arena_, 0x10'0000, 0), 0); }
+    void TearDown() override {
+        EXPECT_EQ(arena_deinit(&arena_), 0);
+        EXPECT_EQ(arena_.pool.pbase, nullptr);
+        EXPECT_EQ(arena_.top, 0);
+    }
+
+protected:
+    arena arena_;
+};
+
+TEST_F(ArenaTest, init) {
+    ASSERT_NE(arena_.pool.pbase, nullptr);
+    EXPECT_EQ(arena_.pool.size, 0);
+    EXPECT_EQ(arena_.pool.capacity, 0x10'0000);
+    EXPECT_EQ(arena_.pool.flags, MEM_MMAP);
+    EXPECT_EQ(arena_.top, 0);
+}
+
+TEST_F(ArenaTest, allocate) {
+    EXPECT_EQ(arena_allocate(&arena_, 0), nullptr); // NO-OP
+
+    auto ptr1 = static_cast<uint8_t*>(arena_allocate(&arena_, 13));
+    EXPECT_EQ(ptr1, arena_.pool.pbase);
+    EXPECT_EQ(arena_.top, 16);
+    EXPECT_GE(arena_.pool.size, arena_.top);
+    std::fill_n(ptr1, 13, 'a');
+
+    auto ptr2 = static_cast<uint8_t*>(arena_allocate(&arena_, 8));
+    EXPECT_EQ(ptr2, ptr1 + 16);
+    EXPECT_EQ(arena_.top, 24);
+    std::fill_n(ptr2, 8, 'b');
+    EXPECT_EQ(std::count(ptr1, ptr1 + 13, 'a'), 13);
+}
+
+TEST_F(ArenaTest, allocate_grows_in_place) {
+    // a pool with room after it
+    ASSERT_EQ(arena_deinit(&arena_), 0);
+    arena_.pool = Utils::MapPoolWithRoomAfter(0x10'0000, 0x10'0000);
+    ASSERT_NE(arena_.pool.pbase, nullptr);
+    const auto pbase = arena_.pool.pbase;
+
+    std::vector<uint8_t*> ptrs;
+    for (uint64_t i = 0; i < 500; ++i) {
+        auto ptr = static_cast<uint8_t*>(arena_allocate(&arena_, 1000));
+        ASSERT_NE(ptr, nullptr) << i;
+        std::fill_n(ptr, 1000, 'a' + i % 26);
+        ptrs.push_back(ptr);
+    }
+    EXPECT_EQ(arena_.pool.pbase, pbase);
+    EXPECT_EQ(arena_.top, 500 * 1000);
+    EXPECT_GE(arena_.pool.size, arena_.top);
+    EXPECT_LT(arena_.pool.size, arena_.pool.capacity); // partly accessible
+
+    // beyond the reserved address space the pool grows in place
+    auto ptr = static_cast<uint8_t*>(arena_allocate(&arena_, 0x10'0000));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(ptr, pbase + 500 * 1000);
+    EXPECT_EQ(arena_.pool.pbase, pbase);
+    EXPECT_GE(arena_.pool.capacity, arena_.top);
+    EXPECT_GE(arena_.pool.size, arena_.top);
+    std::fill_n(ptr, 0x10'0000, 'z');
+    for (uint64_t i = 0; i < ptrs.size(); ++i) {
+        EXPECT_EQ(std::count(ptrs[i], ptrs[i] + 1000, 'a' + i % 26), 1000) << i;
+    }
+}
+
+TEST_F(ArenaTest, allocate_aligned) {
+    ASSERT_NE(arena_allocate(&arena_, 8), nullptr);
+    for (uint64_t alignment = 8; alignment <= 4096; alignment *= 2) {
+        auto ptr = static_cast<uint8_t*>(arena_allocate_aligned(&arena_, 24, alignment));
+        ASSERT_NE(ptr, nullptr) << alignment;
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignment, 0) << alignment;
+        EXPECT_EQ(arena_.top, ptr + 24 - arena_.pool.pbase) << alignment;
+    }
+    // less than 8 is 8
+    auto ptr = static_cast<uint8_t*>(arena_allocate_aligned(&arena_, 3, 2));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 8, 0);
+    EXPECT_EQ(arena_allocate_aligned(&arena_, 0, 16), nullptr);
+    // there is no alignment 0
+    const uint64_t top = arena_.top;
+    EXPECT_EQ(arena_allocate_aligned(&arena_, 8, 0), nullptr);
+    EXPECT_EQ(arena_.top, top);
+}
+
+TEST_F(ArenaTest, mark_and_rewind) {
+    ASSERT_NE(arena_allocate(&arena_, 100), nullptr);
+    const auto mark = arena_mark(&arena_);
+    EXPECT_EQ(mark, 104);
+
+    auto ptr1 = arena_allocate(&arena_, 1000);
+    ASSERT_NE(arena_allocate(&arena_, 1000), nullptr);
+    EXPECT_EQ(arena_rewind(&arena_, mark), 0);
+    EXPECT_EQ(arena_.top, mark);
+    // the memory after the mark is allocated again
+    EXPECT_EQ(arena_allocate(&arena_, 8), ptr1);
+
+    EXPECT_EQ(arena_rewind(&arena_, arena_.top + 8), -EINVAL);
+    EXPECT_EQ(arena_.top, mark + 8);
+
+    arena_reset(&arena_);
+    EXPECT_EQ(arena_.top, 0);
+    EXPECT_EQ(arena_allocate(&arena_, 8), arena_.pool.pbase);
+}
+
+TEST(ArenaDeinitTest, allocate_after_deinit) {
+    arena arena1;
+    ASSERT_EQ(arena_init(&arena1, 0x10'0000, MEM_HUGEPAGES), 0);
+    EXPECT_EQ(arena1.pool.flags, MEM_MMAP | MEM_HUGEPAGES);
+    ASSERT_NE(arena_allocate(&arena1, 8), nullptr);
+    EXPECT_EQ(arena_deinit(&arena1), 0);
+    EXPECT_EQ(arena_allocate(&arena1, 8), nullptr);
+    EXPECT_EQ(arena_allocate_aligned(&arena1, 8, 64), nullptr);
+    EXPECT_EQ(arena_deinit(&arena1), 0);
+}
+
+}
+}
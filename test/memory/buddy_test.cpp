@@ -0,0 +1,150 @@
+#include "memory/buddy.h"
+#include "memory/utils.h"
+
+#include <errno.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+
+namespace memory {
+namespace {
+
+constexpr uint64_t MEM_ORDER = 20;
+constexpr uint64_t MEM_SZ = uint64_t{1} << MEM_ORDER;
+
+class BuddyTest : public ::testing::Test {
+public:
+    void SetUp() override { ASSERT_EQ(buddy_init(&buddy_, MEM_SZ - 100), 0); }
+    void TearDown() override {
+        EXPECT_EQ(buddy_deinit(&buddy_), 0);
+        EXPECT_EQ(buddy_.pool.pbase, nullptr);
+        EXPECT_EQ(buddy_.order, 0);
+        EXPECT_EQ(buddy_.orders, 0);
+    }
+
+protected:
+    uint64_t NumFree(uint64_t order) const {
+        uint64_t num = 0;
+        for (auto pblock = static_cast<void* const*>(buddy_.heads[order]); pblock != nullptr;
+                pblock = static_cast<void* const*>(*pblock)) {
+            ++num;
+        }
+        return num;
+    }
+
+    buddy buddy_;
+};
+
+TEST_F(BuddyTest, init) {
+    ASSERT_NE(buddy_.pool.pbase, nullptr);
+    EXPECT_EQ(buddy_.order, MEM_ORDER);
+    EXPECT_EQ(buddy_.orders, MEM_SZ);
+    EXPECT_EQ(buddy_.heads[MEM_ORDER], buddy_.pool.pbase);
+    EXPECT_EQ(reinterpret_cast<uint8_t*>(buddy_.pfree), buddy_.pool.pbase + MEM_SZ);
+    EXPECT_EQ(_buddy_test(buddy_.pfree, 0), 1);
+    EXPECT_EQ(_buddy_test(buddy_.psplit, 0), 0);
+}
+
+TEST_F(BuddyTest, node) {
+    EXPECT_EQ(_buddy_node(MEM_ORDER, MEM_ORDER, 0), 0);
+    EXPECT_EQ(_buddy_node(MEM_ORDER, MEM_ORDER - 1, 0), 1);
+    EXPECT_EQ(_buddy_node(MEM_ORDER, MEM_ORDER - 1, MEM_SZ / 2), 2);
+    EXPECT_EQ(_buddy_node(MEM_ORDER, MEM_ORDER - 2, 3 * MEM_SZ / 4), 6);
+    EXPECT_EQ(_buddy_node(MEM_ORDER, 4, MEM_SZ - 16), (MEM_SZ / 16) * 2 - 2);
+}
+
+TEST_F(BuddyTest, allocate_splits_blocks) {
+    auto ptr = static_cast<uint8_t*>(buddy_allocate(&buddy_, 100));
+    ASSERT_EQ(ptr, buddy_.pool.pbase);
+    // a block of 128 bytes and one free block of each order from 7 to MEM_ORDER - 1
+    for (uint64_t order = 7; order < MEM_ORDER; ++order) {
+        EXPECT_EQ(NumFree(order), 1) << order;
+    }
+    EXPECT_EQ(NumFree(MEM_ORDER), 0);
+    EXPECT_EQ(buddy_.orders, (MEM_SZ - 1) & ~uint64_t{0x7f});
+
+    auto ptr2 = static_cast<uint8_t*>(buddy_allocate(&buddy_, 128));
+    EXPECT_EQ(ptr2, ptr + 128);
+    EXPECT_EQ(NumFree(7), 0);
+    std::fill_n(ptr, 100, 'a');
+    std::fill_n(ptr2, 128, 'b');
+    EXPECT_EQ(std::count(ptr, ptr + 100, 'a'), 100);
+
+    // no block is smaller than 16 bytes
+    auto ptr3 = static_cast<uint8_t*>(buddy_allocate(&buddy_, 1));
+    EXPECT_EQ(ptr3, ptr + 256);
+    EXPECT_EQ(NumFree(4), 1);
+
+    EXPECT_EQ(buddy_allocate(&buddy_, 0), nullptr);
+    EXPECT_EQ(buddy_allocate(&buddy_, MEM_SZ), nullptr);
+}
+
+TEST_F(BuddyTest, deallocate_joins_buddies) {
+    auto ptr1 = buddy_allocate(&buddy_, 64);
+    auto ptr2 = buddy_allocate(&buddy_, 64);
+    auto ptr3 = buddy_allocate(&buddy_, 128);
+    EXPECT_EQ(NumFree(6), 0);
+
+    EXPECT_EQ(buddy_deallocate(&buddy_, ptr1), 0);
+    EXPECT_EQ(NumFree(6), 1);
+    EXPECT_EQ(buddy_deallocate(&buddy_, ptr2), 0); // joins with ptr1
+    EXPECT_EQ(NumFree(6), 0);
+    EXPECT_EQ(NumFree(7), 1);
+    EXPECT_EQ(buddy_deallocate(&buddy_, ptr3), 0); // joins back into all memory
+    EXPECT_EQ(NumFree(MEM_ORDER), 1);
+    EXPECT_EQ(buddy_.orders, MEM_SZ);
+    EXPECT_EQ(buddy_allocate(&buddy_, MEM_SZ), buddy_.pool.pbase);
+}
+
+TEST_F(BuddyTest, deallocate_invalid) {
+    auto ptr = static_cast<uint8_t*>(buddy_allocate(&buddy_, 64));
+    EXPECT_EQ(buddy_deallocate(&buddy_, nullptr), -EINVAL);
+    EXPECT_EQ(buddy_deallocate(&buddy_, ptr + 8), -EINVAL); // not the begin of the block
+    EXPECT_EQ(buddy_deallocate(&buddy_, ptr + 64), -EINVAL); // free
+    EXPECT_EQ(buddy_deallocate(&buddy_, buddy_.pool.pbase + MEM_SZ), -EINVAL);
+    EXPECT_EQ(buddy_deallocate(&buddy_, ptr), 0);
+    EXPECT_EQ(buddy_deallocate(&buddy_, ptr), -EINVAL); // twice
+}
+
+TEST_F(BuddyTest, random) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint64_t> sizes(1, 5000);
+    std::map<uint8_t*, uint64_t> live; // block and its size
+    for (int i = 0; i < 10'000; ++i) {
+        if (!live.empty() && gen() % 2 == 0) {
+            auto it = std::next(live.begin(), gen() % live.size());
+            EXPECT_EQ(std::count(it->first, it->first + it->second, 'a' + it->second % 26),
+                  it->second);
+            EXPECT_EQ(buddy_deallocate(&buddy_, it->first), 0);
+            live.erase(it);
+        } else {
+            const uint64_t size = sizes(gen);
+            auto ptr = static_cast<uint8_t*>(buddy_allocate(&buddy_, size));
+            if (ptr == nullptr) {
+                continue;
+            }
+            const uint64_t block_sz = std::max<uint64_t>(16, mem_power_of_2_ceiling(size));
+            EXPECT_EQ((ptr - buddy_.pool.pbase) % block_sz, 0);
+            std::fill_n(ptr, size, 'a' + size % 26);
+            live[ptr] = size;
+        }
+    }
+    for (const auto& [ptr, size] : live) {
+        EXPECT_EQ(buddy_deallocate(&buddy_, ptr), 0);
+    }
+    EXPECT_EQ(buddy_.orders, MEM_SZ);
+}
+
+TEST(BuddyInitTest, minimum_size) {
+    buddy buddy1;
+    ASSERT_EQ(buddy_init(&buddy1, 100), 0);
+    EXPECT_EQ(buddy1.order, 12);
+    EXPECT_EQ(buddy_deinit(&buddy1), 0);
+    EXPECT_EQ(buddy_allocate(&buddy1, 16), nullptr);
+}
+
+}
+}
@@ -0,0 +1,365 @@
+#include "memory/linear.h"
+#include "memory/utils.h"
+#include "mtrace/trace.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t BIG_ALLOCATION = 4096;
+
+// Pool with `num_holes` free segments of 8 bytes separated by used segments of 8 bytes followed
+// by one big free segment at the end. Only the last free segment can fit BIG_ALLOCATION.
+class FragmentedPool {
+public:
+    explicit FragmentedPool(uint64_t num_holes)
+          : mem_sz_(mem_power_of_2_ceiling(num_holes * 16 + 0x10'0000)),
+            // MSHs inserted in order leave the MAV pages half full
+            mav_sz_(mem_power_of_2_ceiling((2 * num_holes + 2) * 16 * 2 + 8192)),
+            pool_(new uint64_t[(mem_sz_ + 2 * mav_sz_) / 8]) {
+        auto pmem = reinterpret_cast<uint8_t*>(pool_.get());
+        auto mavh = _linear_set_mavh(mem_sz_, mav_sz_, 0, 0);
+        _linear_mav_init(mavh, pmem);
+        for (uint64_t i = 0; i < num_holes; ++i) {
+            mavh = _linear_put_free_msh(mavh, pmem, _linear_set_msh(i * 16, 8, mavh));
+            mavh = _linear_insert_used_msh(mavh, pmem, _linear_set_msh(i * 16 + 8, 8, mavh));
+        }
+        mavh = _linear_put_free_msh(
+              mavh, pmem, _linear_set_msh(num_holes * 16, mem_sz_ - num_holes * 16, mavh));
+
+        _mem_pbase = pmem;
+        _mem_size = mem_sz_ + 2 * mav_sz_;
+        _linear_mavh = mavh;
+        _linear_bins[0] = 0; // bins are rebuilt for the new MAV
+        _linear_bins_sync(_linear_bins, _linear_mavh, _mem_pbase);
+    }
+
+    ~FragmentedPool() {
+        _linear_mavh = 0;
+        _linear_bins[0] = 0;
+        _mem_pbase = nullptr;
+        _mem_size = 0;
+    }
+
+private:
+    const uint64_t mem_sz_;
+    const uint64_t mav_sz_;
+    std::unique_ptr<uint64_t[]> pool_;
+};
+
+void BM_FindFreeMsh_FirstFit(benchmark::State& state) {
+    const FragmentedPool pool(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(_linear_find_free_msh(_linear_mavh, _mem_pbase, BIG_ALLOCATION));
+    }
+}
+
+void BM_FindFreeMsh_SizeClassBins(benchmark::State& state) {
+    const FragmentedPool pool(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+              _linear_bins_find_free_msh(_linear_bins, _linear_mavh, _mem_pbase, BIG_ALLOCATION));
+    }
+}
+
+void BM_FindUsedMsh(benchmark::State& state) {
+    const FragmentedPool pool(state.range(0));
+    const uint8_t* last = _mem_pbase + (state.range(0) - 1) * 16 + 8;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(_linear_find_used_msh(_linear_mavh, _mem_pbase, last));
+    }
+}
+
+void BM_AllocateDeallocate(benchmark::State& state) {
+    const FragmentedPool pool(state.range(0));
+    for (auto _ : state) {
+        void* ptr = linear_allocate(BIG_ALLOCATION);
+        benchmark::DoNotOptimize(ptr);
+        linear_deallocate(ptr);
+    }
+}
+
+// the first 64 of state.range(0) holes are filled and emptied again: the pages at the start of the
+// free region merge and split, which only touches the nodes above them in MAV (the time per
+// operation does not grow with state.range(0))
+void BM_DirectoryMoves(benchmark::State& state) {
+    constexpr uint64_t NUM_BLOCKS = 64;
+    const FragmentedPool pool(state.range(0));
+    std::vector<void*> ptrs(NUM_BLOCKS);
+    for (auto _ : state) {
+        for (auto& ptr : ptrs) {
+            ptr = linear_allocate(8);
+        }
+        benchmark::DoNotOptimize(ptrs.data());
+        for (const auto ptr : ptrs) {
+            linear_deallocate(ptr);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * NUM_BLOCKS);
+}
+
+// Pool shared by the threads of the concurrent benchmarks
+class ConcurrentPool {
+public:
+    ConcurrentPool()
+          : pool_(new uint64_t[POOL_SZ / 8]) {
+        _mem_pbase = reinterpret_cast<uint8_t*>(pool_.get());
+        _mem_size = POOL_SZ;
+        linear_init_with_options(POOL_SZ / 2, LINEAR_CONCURRENT);
+    }
+
+    ~ConcurrentPool() {
+        linear_deinit();
+        _mem_pbase = nullptr;
+        _mem_size = 0;
+    }
+
+private:
+    static constexpr uint64_t POOL_SZ = 0x1000'0000;
+    std::unique_ptr<uint64_t[]> pool_;
+};
+
+// each thread keeps NUM_LIVE blocks and replaces the oldest one at every iteration
+void BM_ConcurrentAllocateDeallocate(benchmark::State& state) {
+    constexpr size_t NUM_LIVE = 64;
+    static std::unique_ptr<ConcurrentPool> pool;
+    if (state.thread_index() == 0) {
+        pool.reset(); // the previous run is over
+        pool = std::make_unique<ConcurrentPool>();
+    }
+    const uint64_t size = state.range(0);
+    std::vector<void*> live(NUM_LIVE, nullptr);
+    size_t oldest = 0;
+    for (auto _ : state) {
+        linear_deallocate(live[oldest]);
+        live[oldest] = linear_allocate(size);
+        benchmark::DoNotOptimize(live[oldest]);
+        oldest = (oldest + 1) % NUM_LIVE;
+    }
+    for (auto ptr : live) {
+        linear_deallocate(ptr);
+    }
+    linear_thread_flush();
+    state.SetItemsProcessed(state.iterations());
+}
+
+// a vector of uint64_t that doubles its capacity when it is full grows to state.range(0) elements
+void BM_VectorGrowth_Reallocate(benchmark::State& state) {
+    const uint64_t num_elements = state.range(0);
+    linear_arena arena;
+    linear_arena_create(&arena, 4 * num_elements * sizeof(uint64_t));
+    for (auto _ : state) {
+        uint64_t capacity = 1;
+        auto data = static_cast<uint64_t*>(linear_arena_allocate(&arena, sizeof(uint64_t)));
+        for (uint64_t i = 0; i < num_elements; ++i) {
+            if (i == capacity) {
+                capacity *= 2;
+                data = static_cast<uint64_t*>(
+                      linear_arena_reallocate(&arena, data, capacity * sizeof(uint64_t)));
+            }
+            data[i] = i;
+        }
+        benchmark::DoNotOptimize(data);
+        linear_arena_deallocate(&arena, data);
+    }
+    linear_arena_destroy(&arena);
+    state.SetItemsProcessed(state.iterations() * num_elements);
+}
+
+void BM_VectorGrowth_AllocateCopy(benchmark::State& state) {
+    const uint64_t num_elements = state.range(0);
+    linear_arena arena;
+    linear_arena_create(&arena, 4 * num_elements * sizeof(uint64_t));
+    for (auto _ : state) {
+        uint64_t capacity = 1;
+        auto data = static_cast<uint64_t*>(linear_arena_allocate(&arena, sizeof(uint64_t)));
+        for (uint64_t i = 0; i < num_elements; ++i) {
+            if (i == capacity) {
+                capacity *= 2;
+                auto new_data = static_cast<uint64_t*>(
+                      linear_arena_allocate(&arena, capacity * sizeof(uint64_t)));
+                mem_copy_n(data, i * sizeof(uint64_t), new_data);
+                linear_arena_deallocate(&arena, data);
+                data = new_data;
+            }
+            data[i] = i;
+        }
+        benchmark::DoNotOptimize(data);
+        linear_arena_deallocate(&arena, data);
+    }
+    linear_arena_destroy(&arena);
+    state.SetItemsProcessed(state.iterations() * num_elements);
+}
+
+// state.range(0) nodes of 32 bytes are allocated and then deallocated in the order they came
+void BM_Nodes_Batch(benchmark::State& state) {
+    const uint64_t num_nodes = state.range(0);
+    const std::vector<uint64_t> sizes(num_nodes, 32);
+    std::vector<void*> ptrs(num_nodes);
+    linear_arena arena;
+    linear_arena_create(&arena, 4 * num_nodes * 32);
+    for (auto _ : state) {
+        linear_arena_allocate_batch(&arena, sizes.data(), num_nodes, ptrs.data());
+        benchmark::DoNotOptimize(ptrs.data());
+        linear_arena_deallocate_batch(&arena, ptrs.data(), num_nodes);
+    }
+    linear_arena_destroy(&arena);
+    state.SetItemsProcessed(state.iterations() * num_nodes);
+}
+
+void BM_Nodes_OneByOne(benchmark::State& state) {
+    const uint64_t num_nodes = state.range(0);
+    std::vector<void*> ptrs(num_nodes);
+    linear_arena arena;
+    linear_arena_create(&arena, 4 * num_nodes * 32);
+    for (auto _ : state) {
+        for (auto& ptr : ptrs) {
+            ptr = linear_arena_allocate(&arena, 32);
+        }
+        benchmark::DoNotOptimize(ptrs.data());
+        for (const auto ptr : ptrs) {
+            linear_arena_deallocate(&arena, ptr);
+        }
+    }
+    linear_arena_destroy(&arena);
+    state.SetItemsProcessed(state.iterations() * num_nodes);
+}
+
+// the time to set up a pool of state.range(0) bytes (mapped: every iteration gets fresh pages)
+void BM_Init(benchmark::State& state, uint64_t options) {
+    const uint64_t size = state.range(0);
+    for (auto _ : state) {
+        linear_init_with_options(size, LINEAR_MMAP | options);
+        benchmark::DoNotOptimize(linear_allocate(64));
+        linear_deinit();
+    }
+}
+
+void BM_Init_Lazy(benchmark::State& state) {
+    BM_Init(state, 0);
+}
+
+void BM_Init_Poison(benchmark::State& state) {
+    BM_Init(state, LINEAR_POISON);
+}
+
+// state.range(0) live blocks of a few small sizes: each iteration replaces one of them by a block
+// of the same size (7 times out of 8) or of another size
+void BM_Churn(benchmark::State& state, uint64_t options) {
+    constexpr uint64_t SIZES[] = { 16, 32, 32, 48, 64, 64, 64, 128 };
+    const uint64_t num_live = state.range(0);
+    linear_init_with_options(64 << 20, LINEAR_MMAP | options);
+    std::vector<void*> live(num_live);
+    std::vector<uint64_t> sizes(num_live);
+    for (uint64_t i = 0; i < num_live; ++i) {
+        sizes[i] = SIZES[i % 8];
+        live[i] = linear_allocate(sizes[i]);
+    }
+    uint64_t seed = 1;
+    for (auto _ : state) {
+        seed = seed * 6364136223846793005 + 1442695040888963407;
+        const uint64_t i = (seed >> 33) % num_live;
+        if ((seed >> 61) == 0) {
+            sizes[i] = SIZES[(seed >> 20) % 8];
+        }
+        linear_deallocate(live[i]);
+        live[i] = linear_allocate(sizes[i]);
+        benchmark::DoNotOptimize(live[i]);
+    }
+    linear_deinit();
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_Churn_Immediate(benchmark::State& state) {
+    BM_Churn(state, 0);
+}
+
+void BM_Churn_Deferred(benchmark::State& state) {
+    BM_Churn(state, LINEAR_DEFERRED);
+}
+
+// replay the trace in a fresh pool and return the peak fragmentation (ppm) if it is sampled
+uint64_t ReplayTrace(
+      const mtrace::Trace& trace,
+      std::vector<void*>& slots,
+      uint64_t options,
+      bool sample) {
+    linear_init_with_options(256 << 20, LINEAR_MMAP | options);
+    uint64_t peak_fragmentation = 0;
+    linear_statistics stats;
+    for (size_t i = 0; i < trace.events.size(); ++i) {
+        const auto& event = trace.events[i];
+        if (event.kind == mtrace::EventKind::DEALLOCATE) {
+            linear_deallocate(slots[event.slot]);
+        } else {
+            slots[event.slot] = linear_allocate(event.size);
+        }
+        if (sample && i % 256 == 0 && linear_stats(&stats) == 0) {
+            peak_fragmentation = std::max(peak_fragmentation, stats.fragmentation);
+        }
+    }
+    linear_deinit();
+    return peak_fragmentation;
+}
+
+// throughput of each placement policy replaying a trace of state.range(0) events (the peak
+// fragmentation is sampled in a replay out of the timing)
+void BM_Placement(benchmark::State& state, uint64_t policy) {
+    const auto trace = mtrace::SyntheticTrace(state.range(0), 4096);
+    std::vector<void*> slots(trace.num_slots, nullptr);
+    for (auto _ : state) {
+        ReplayTrace(trace, slots, policy, false);
+    }
+    state.counters["peak_fragmentation_ppm"] =
+          static_cast<double>(ReplayTrace(trace, slots, policy, true));
+    state.SetItemsProcessed(state.iterations() * trace.events.size());
+}
+
+void BM_Placement_SizeClasses(benchmark::State& state) {
+    BM_Placement(state, 0);
+}
+
+void BM_Placement_FirstFit(benchmark::State& state) {
+    BM_Placement(state, LINEAR_FIRST_FIT);
+}
+
+void BM_Placement_NextFit(benchmark::State& state) {
+    BM_Placement(state, LINEAR_NEXT_FIT);
+}
+
+void BM_Placement_BestFit(benchmark::State& state) {
+    BM_Placement(state, LINEAR_BEST_FIT);
+}
+
+BENCHMARK(BM_FindFreeMsh_FirstFit)->RangeMultiplier(10)->Range(10, 1'000'000);
+BENCHMARK(BM_FindFreeMsh_SizeClassBins)->RangeMultiplier(10)->Range(10, 1'000'000);
+BENCHMARK(BM_FindUsedMsh)->RangeMultiplier(10)->Range(10, 1'000'000);
+BENCHMARK(BM_AllocateDeallocate)->RangeMultiplier(10)->Range(10, 1'000'000);
+BENCHMARK(BM_DirectoryMoves)->RangeMultiplier(10)->Range(1'000, 1'000'000);
+BENCHMARK(BM_VectorGrowth_Reallocate)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK(BM_VectorGrowth_AllocateCopy)->RangeMultiplier(16)->Range(16, 1 << 20);
+BENCHMARK(BM_Nodes_Batch)->RangeMultiplier(10)->Range(10, 100'000);
+BENCHMARK(BM_Nodes_OneByOne)->RangeMultiplier(10)->Range(10, 100'000);
+BENCHMARK(BM_Churn_Immediate)->RangeMultiplier(10)->Range(100, 1'000'000);
+BENCHMARK(BM_Churn_Deferred)->RangeMultiplier(10)->Range(100, 1'000'000);
+BENCHMARK(BM_Placement_SizeClasses)->RangeMultiplier(10)->Range(1'000, 100'000);
+BENCHMARK(BM_Placement_FirstFit)->RangeMultiplier(10)->Range(1'000, 100'000);
+BENCHMARK(BM_Placement_NextFit)->RangeMultiplier(10)->Range(1'000, 100'000);
+BENCHMARK(BM_Placement_BestFit)->RangeMultiplier(10)->Range(1'000, 100'000);
+// pools from 64 MB to 4 GB
+BENCHMARK(BM_Init_Lazy)
+      ->RangeMultiplier(4)
+      ->Range(64 << 20, int64_t{ 4 } << 30)
+      ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Init_Poison)
+      ->RangeMultiplier(4)
+      ->Range(64 << 20, int64_t{ 4 } << 30)
+      ->Unit(benchmark::kMillisecond);
+// 64 bytes blocks are cached by the threads, 4096 bytes blocks always take the lock
+BENCHMARK(BM_ConcurrentAllocateDeallocate)->Arg(64)->Arg(4096)->ThreadRange(1, 16)->UseRealTime();
+} // namespace
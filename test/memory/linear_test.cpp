@@ -6,15 +6,20 @@
 #include <errno.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cctype>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <limits>
 #include <ostream>
 #include <random>
 #include <sstream>
+#include <thread>
+#include <utility>
 
 namespace memory {
 namespace {
@@ -100,12 +105,6 @@ struct MshT {
     void IncreaseSize(const MshT& y) { s_ += y.s_; }
     constexpr bool FollowedBy(const MshT& x) const { return Offset() + Size() == x.Offset(); }
 
-    static MshT GetAt(const uint8_t* buffer, size_t offset) {
-        uint64_t val;
-        std::memcpy(&val, buffer + offset, sizeof(val));
-        return MshT(val);
-    }
-
 private:
     uint64_t o_;
     uint64_t s_;
@@ -114,6 +113,10 @@ private:
 using VecSegsT = std::vector<MshT>;
 using BufferT = std::vector<uint8_t>;
 
+bool OrderByOffset(const MshT& x, const MshT& y) {
+    return x.Offset() < y.Offset();
+}
+
 class LinearUtils {
 public:
     static std::string MavhToString(uint64_t mavh) {
@@ -128,35 +131,65 @@ public:
         return out.str();
     }
 
-    static MavhT PrepareFreeSegments(const MavhT& mavh0, uint64_t* pmav_f, const VecSegsT& segs) {
-        for (size_t i = 0; i < segs.size(); ++i) {
-            const auto seg = segs[i].ToMsh();
-            memcpy(pmav_f + i, &seg, sizeof(seg));
+    // build a MAV (in pmem + mem_sz) that holds exactly the free and the used segments
+    static MavhT PrepareSegments(
+          const MavhT& mavh0,
+          uint8_t* pmem,
+          const VecSegsT& free_segs,
+          const VecSegsT& used_segs) {
+        auto mavh = MavhT(mavh0.MemSz(), mavh0.MavSz(), 0, 0).ToMavh();
+        _linear_mav_init(mavh, pmem);
+        for (const auto& seg : free_segs) {
+            mavh = _linear_put_free_msh(mavh, pmem, seg.ToMsh());
+        }
+        for (const auto& seg : used_segs) {
+            mavh = _linear_insert_used_msh(mavh, pmem, seg.ToMsh());
         }
-        return MavhT(mavh0.MemSz(), mavh0.MavSz(), segs.size(), mavh0.NumUsed());
+        return MavhT(mavh);
     }
 
-    static MavhT PrepareUsedSegments(const MavhT& mavh0, uint64_t* pmav_u, const VecSegsT& segs) {
-        for (size_t i = 0; i < segs.size(); ++i) {
-            const auto seg = segs[i].ToMsh();
-            memcpy(pmav_u - i - 1, &seg, sizeof(seg));
+    static MavhT PrepareFreeSegments(const MavhT& mavh0, uint8_t* pmem, const VecSegsT& segs) {
+        return PrepareSegments(mavh0, pmem, segs, {});
+    }
+
+    static MavhT PrepareUsedSegments(const MavhT& mavh0, uint8_t* pmem, const VecSegsT& segs) {
+        return PrepareSegments(mavh0, pmem, {}, segs);
+    }
+
+    // the # of free and of used MSHs kept in the directory page of MAV (after the first empty page)
+    static uint64_t* SegmentCounts(const MavhT& mavh, uint8_t* pmem) {
+        return reinterpret_cast<uint64_t*>(pmem + mavh.FullSz() - 512 + 8);
+    }
+
+    static VecSegsT FreeSegments(const MavhT& mavh, const uint8_t* pmem) {
+        VecSegsT segs;
+        for (size_t i = 0; i < mavh.NumFree(); ++i) {
+            segs.emplace_back(*_linear_free_msh_at(mavh.ToMavh(), pmem, i));
         }
-        return MavhT(mavh0.MemSz(), mavh0.MavSz(), mavh0.NumFree(), segs.size());
+        return segs;
+    }
+
+    static VecSegsT UsedSegments(const MavhT& mavh, const uint8_t* pmem) {
+        VecSegsT segs;
+        for (size_t i = 0; i < mavh.NumUsed(); ++i) {
+            segs.emplace_back(*_linear_used_msh_at(mavh.ToMavh(), pmem, i));
+        }
+        return segs;
     }
 
     static void PrintSegments(const MavhT& mavh, const uint8_t* pmem) {
-        const auto pmav_f = reinterpret_cast<const uint64_t*>(pmem + mavh.MemSz());
-        const auto pmav_u = reinterpret_cast<const uint64_t*>(pmem + mavh.MemSz() + mavh.MavSz());
         std::cout << '\n' << std::string(100, '_') << '\n';
         std::cout << "In memory segments\n";
         std::cout << "pmem = " << std::hex << reinterpret_cast<const uint64_t*>(pmem) << '\n';
         std::cout << std::dec;
         std::cout << mavh << '\n';
-        for (size_t i = 0; i < mavh.NumFree(); ++i) {
-            std::cout << i << " free " << MshT(*(pmav_f + i)) << '\n';
+        const auto free_segs = FreeSegments(mavh, pmem);
+        for (size_t i = 0; i < free_segs.size(); ++i) {
+            std::cout << i << " free " << free_segs[i] << '\n';
         }
-        for (size_t i = 0; i < mavh.NumUsed(); ++i) {
-            std::cout << i << " used " << MshT(*(pmav_u - i - 1)) << '\n';
+        const auto used_segs = UsedSegments(mavh, pmem);
+        for (size_t i = 0; i < used_segs.size(); ++i) {
+            std::cout << i << " used " << used_segs[i] << '\n';
         }
         std::cout << std::string(100, '-') << '\n';
     }
@@ -170,6 +203,68 @@ public:
         std::cout << std::string(100, '-') << '\n';
     }
 
+    static uint64_t BinsNode(const uint8_t* pmem, uint64_t o) {
+        uint64_t val;
+        std::memcpy(&val, pmem + o * 8, sizeof(val));
+        return val;
+    }
+
+    // check that the size class bins link exactly the (non empty) free segments
+    static void CheckBins(
+          int line,
+          const uint64_t* pbins,
+          const uint8_t* pmem,
+          const VecSegsT& free) {
+        SCOPED_TRACE("from line " + std::to_string(line));
+        constexpr uint64_t nil = 0xffff'ffff;
+        std::vector<MshT> linked;
+        for (uint64_t k = 0; k < 64; ++k) {
+            uint64_t o = pbins[2 + k];
+            EXPECT_EQ(o != nil, ((pbins[1] >> k) & 1) != 0) << "class " << k;
+            uint64_t prev = nil;
+            while (o != nil) {
+                const uint64_t node = BinsNode(pmem, o);
+                EXPECT_EQ(node & nil, prev) << "class " << k << " o " << o;
+                const auto it = std::find_if(free.begin(), free.end(), [o](const MshT& msh) {
+                    return msh.O() == o;
+                });
+                if (it == free.end()) {
+                    ADD_FAILURE() << "class " << k << " links unknown block " << o;
+                    break;
+                }
+                EXPECT_EQ(_linear_size_class(it->Size()), k) << *it;
+                linked.push_back(*it);
+                prev = o;
+                o = node >> 32;
+            }
+        }
+        std::sort(linked.begin(), linked.end(), OrderByOffset);
+        VecSegsT expected;
+        std::copy_if(free.begin(), free.end(), std::back_inserter(expected), [](const MshT& msh) {
+            return msh.Size() != 0;
+        });
+        EXPECT_EQ(linked, expected);
+
+        // the counters follow the linked blocks
+        uint64_t free_sz = 0;
+        std::vector<uint64_t> counts(64, 0);
+        std::vector<uint64_t> largest(64, 0);
+        for (const auto& msh : linked) {
+            free_sz += msh.Size();
+            const auto k = _linear_size_class(msh.Size());
+            ++counts[k];
+            largest[k] = std::max(largest[k], msh.Size());
+        }
+        EXPECT_EQ(pbins[66], free_sz);
+        EXPECT_EQ(std::vector<uint64_t>(pbins + 68, pbins + 132), counts);
+        // the largest block of a class is kept unless it is not known (0)
+        for (uint64_t k = 0; k < 64; ++k) {
+            if (pbins[134 + k] != 0) {
+                EXPECT_EQ(pbins[134 + k], largest[k]) << "class " << k;
+            }
+        }
+    }
+
     static void PrintMemory(const MavhT& mavh, const uint8_t* pmem) {
         std::cout << '\n' << std::string(100, '_') << '\n';
         for (size_t i = 0; i < mavh.MemSz(); ++i) {
@@ -190,7 +285,7 @@ public:
     void SetUp() override;
     void TearDown() override;
 
-    void CheckInited(int line);
+    void CheckInited(int line, uint64_t options = 0);
 
     const uint64_t requested_pool_size_;
     const uint64_t effective_pool_size_;
@@ -210,7 +305,7 @@ void LinearTest::TearDown() {
     MemoryTestBase::TearDown();
 }
 
-void LinearTest::CheckInited(int line) {
+void LinearTest::CheckInited(int line, uint64_t options) {
     SCOPED_TRACE("from line " + std::to_string(line));
     const uint64_t mem_sz = mem_power_of_2_ceiling(requested_pool_size_);
     const uint64_t mav_sz = 4096;
@@ -219,19 +314,17 @@ void LinearTest::CheckInited(int line) {
 
     const MavhT mavh(mem_sz, mav_sz, 1, 0);
     EXPECT_EQ(MavhT(_linear_mavh), mavh);
+    EXPECT_EQ(_linear_options, options);
 
-    // when memory is allocated it is filled with '-'
+    // memory is filled with '-' only if asked to (otherwise it is left as the test filled it)
+    const uint8_t fill = (options & LINEAR_POISON) != 0 ? '-' : 'x';
     for (size_t i = 0; i < mem_sz; ++i) {
-        EXPECT_EQ(pool_[i], '-') << "at offset " << i;
-    }
-    for (size_t i = 8; i < mav_sz; ++i) { // 8 to skip first free MSH that is filled
-        EXPECT_EQ(pool_[mem_sz + i], '-') << "at offset " << i;
+        EXPECT_EQ(pool_[i], fill) << "at offset " << i;
     }
 
     // check the first MSH
-    const auto pmav_f = reinterpret_cast<const uint64_t*>(pool_ + mem_sz);
-    const MshT msh(0, mem_sz);
-    EXPECT_EQ(MshT(*pmav_f), msh);
+    const VecSegsT free_segs = { MshT(0, mem_sz) };
+    EXPECT_EQ(LinearUtils::FreeSegments(mavh, pool_), free_segs);
 }
 
 TEST_F(LinearTest, inited) {
@@ -244,6 +337,12 @@ TEST_F(LinearTest, init_a_second_time_return_error) {
     CheckInited(__LINE__);
 }
 
+TEST_F(LinearTest, init_with_poison) {
+    linear_deinit();
+    EXPECT_EQ(linear_init_with_options(requested_pool_size_, LINEAR_POISON), 0);
+    CheckInited(__LINE__, LINEAR_POISON);
+}
+
 TEST_F(LinearTest, deinit) {
     linear_deinit();
     EXPECT_EQ(_linear_mavh, 0);
@@ -259,8 +358,8 @@ TEST_F(LinearTest, allocate) {
     EXPECT_EQ(mavh1.NumFree(), mavh0.NumFree());
     EXPECT_EQ(mavh1.NumUsed(), mavh0.NumUsed() + 1);
 
-    auto msh_f = MshT::GetAt(pool_, mavh0.MemSz());
-    auto msh_u_0 = MshT::GetAt(pool_, mavh0.FullSz() - 8);
+    auto msh_f = MshT(*_linear_free_msh_at(_linear_mavh, pool_, 0));
+    auto msh_u_0 = MshT(*_linear_used_msh_at(_linear_mavh, pool_, 0));
 
     EXPECT_EQ(msh_f, MshT(0, mavh0.MemSz() - 64));
     EXPECT_EQ(msh_u_0, MshT(mavh0.MemSz() - 64, 64));
@@ -274,9 +373,9 @@ TEST_F(LinearTest, allocate) {
     EXPECT_EQ(mavh2.NumFree(), mavh0.NumFree());
     EXPECT_EQ(mavh2.NumUsed(), mavh0.NumUsed() + 2);
 
-    msh_f = MshT::GetAt(pool_, mavh0.MemSz());
-    msh_u_0 = MshT::GetAt(pool_, mavh0.FullSz() - 8);
-    auto msh_u_1 = MshT::GetAt(pool_, mavh0.FullSz() - 16);
+    msh_f = MshT(*_linear_free_msh_at(_linear_mavh, pool_, 0));
+    msh_u_0 = MshT(*_linear_used_msh_at(_linear_mavh, pool_, 0));
+    auto msh_u_1 = MshT(*_linear_used_msh_at(_linear_mavh, pool_, 1));
 
     EXPECT_EQ(msh_f, MshT(0, mavh0.MemSz() - 64 - 512));
     EXPECT_EQ(msh_u_0, MshT(mavh0.MemSz() - 64 - 512, 512));
@@ -288,30 +387,36 @@ TEST_F(LinearTest, allocate_until_resize_mavh) {
     constexpr uint64_t ALLOC_SZ = 16;
     auto expected_ptr = _mem_pbase + mavh0.MemSz();
     auto num_used = mavh0.NumUsed();
-    for (size_t i = 0; i < 511; ++i) {
-        SCOPED_TRACE("Allocation " + std::to_string(i));
+    // MAV doubles when it has too few empty pages for a new MSH
+    while (MavhT(_linear_mavh).MavSz() == mavh0.MavSz()) {
+        SCOPED_TRACE("Allocation " + std::to_string(num_used));
+        ASSERT_LT(num_used, mavh0.MavSz() / 8);
         expected_ptr -= ALLOC_SZ;
         num_used += 1;
-        auto expected_mavh = MavhT(mavh0.MemSz(), mavh0.MavSz(), mavh0.NumFree(), num_used);
         EXPECT_EQ(linear_allocate(ALLOC_SZ), expected_ptr);
-        EXPECT_EQ(MavhT(_linear_mavh), expected_mavh);
+        EXPECT_EQ(MavhT(_linear_mavh).NumFree(), mavh0.NumFree());
+        EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), num_used);
     }
-
-    expected_ptr -= ALLOC_SZ;
-    num_used += 1;
     const auto mavh1 = MavhT(mavh0.MemSz(), mavh0.MavSz() * 2, mavh0.NumFree(), num_used);
-    EXPECT_EQ(linear_allocate(ALLOC_SZ), expected_ptr);
     EXPECT_EQ(MavhT(_linear_mavh), mavh1);
 
-    // check that all msh were copied
-    auto expected_offset = mavh0.MemSz() - 512 * ALLOC_SZ;
-    auto pmsh = reinterpret_cast<uint64_t*>(_mem_pbase + mavh1.FullSz());
-
+    // the MSHs kept going to the new pages of MAV
     for (size_t i = 0; i < 512; ++i) {
+        SCOPED_TRACE("Allocation " + std::to_string(num_used));
+        expected_ptr -= ALLOC_SZ;
+        num_used += 1;
+        EXPECT_EQ(linear_allocate(ALLOC_SZ), expected_ptr);
+    }
+
+    // check that all msh were kept
+    const auto mavh2 = MavhT(_linear_mavh);
+    EXPECT_EQ(mavh2.NumUsed(), num_used);
+    auto expected_offset = mavh0.MemSz() - num_used * ALLOC_SZ;
+    const auto used_segs = LinearUtils::UsedSegments(mavh2, _mem_pbase);
+    ASSERT_EQ(used_segs.size(), num_used);
+    for (size_t i = 0; i < num_used; ++i) {
         SCOPED_TRACE("Verification " + std::to_string(i));
-        pmsh -= 1;
-        MshT expected_msh(expected_offset, ALLOC_SZ);
-        EXPECT_EQ(MshT(*pmsh), expected_msh);
+        EXPECT_EQ(used_segs[i], MshT(expected_offset, ALLOC_SZ));
         expected_offset += ALLOC_SZ;
     }
 }
@@ -328,8 +433,8 @@ TEST_F(LinearTest, allocate_until_remove_msh) {
     EXPECT_EQ(mavh1.NumFree(), mavh0.NumFree());
     EXPECT_EQ(mavh1.NumUsed(), mavh0.NumUsed() + 1);
 
-    auto msh_f = MshT::GetAt(pool_, mavh0.MemSz());
-    auto msh_u = MshT::GetAt(pool_, mavh0.FullSz() - 8);
+    auto msh_f = MshT(*_linear_free_msh_at(_linear_mavh, pool_, 0));
+    auto msh_u = MshT(*_linear_used_msh_at(_linear_mavh, pool_, 0));
 
     EXPECT_EQ(msh_f, MshT(0, mavh0.MemSz() - alloc_size));
     EXPECT_EQ(msh_u, MshT(mavh0.MemSz() - alloc_size, alloc_size));
@@ -344,7 +449,7 @@ TEST_F(LinearTest, allocate_until_remove_msh) {
     EXPECT_EQ(mavh2.NumFree(), mavh0.NumFree() - 1);
     EXPECT_EQ(mavh2.NumUsed(), mavh0.NumUsed() + 2);
 
-    msh_u = MshT::GetAt(pool_, mavh0.FullSz() - 8);
+    msh_u = MshT(*_linear_used_msh_at(_linear_mavh, pool_, 0));
 
     EXPECT_EQ(msh_u, MshT(0, alloc_size));
 }
@@ -359,8 +464,8 @@ TEST_F(LinearTest, allocate_filled) {
     EXPECT_EQ(mavh1.NumFree(), mavh0.NumFree());
     EXPECT_EQ(mavh1.NumUsed(), mavh0.NumUsed() + 1);
 
-    auto msh_f = MshT::GetAt(pool_, mavh0.MemSz());
-    auto msh_u_0 = MshT::GetAt(pool_, mavh0.FullSz() - 8);
+    auto msh_f = MshT(*_linear_free_msh_at(_linear_mavh, pool_, 0));
+    auto msh_u_0 = MshT(*_linear_used_msh_at(_linear_mavh, pool_, 0));
 
     EXPECT_EQ(msh_f, MshT(0, mavh0.MemSz() - 64));
     EXPECT_EQ(msh_u_0, MshT(mavh0.MemSz() - 64, 64));
@@ -387,11 +492,7 @@ void PrepareMemoryAllocation(
         offset = seg.Offset() + seg.Size();
     }
     free_segs.emplace_back(offset, mavh.MemSz() - offset);
-    const auto pmav_f = reinterpret_cast<uint64_t*>(buffer + mavh.MemSz());
-    const auto pmav_u = reinterpret_cast<uint64_t*>(buffer + mavh.MemSz() + mavh.MavSz());
-    LinearUtils::PrepareFreeSegments(mavh, pmav_f, free_segs);
-    LinearUtils::PrepareUsedSegments(mavh, pmav_u, used_segs);
-    mavh = MavhT(mavh.MemSz(), mavh.MavSz(), free_segs.size(), used_segs.size());
+    mavh = LinearUtils::PrepareSegments(mavh, buffer, free_segs, used_segs);
 }
 
 void CheckMemoryAllocation(
@@ -403,16 +504,10 @@ void CheckMemoryAllocation(
     SCOPED_TRACE("From line " + std::to_string(line) + " / " + mavh.ToString());
     EXPECT_EQ(mavh.NumFree(), free_segs.size());
     EXPECT_EQ(mavh.NumUsed(), used_segs.size());
-    const auto pmav_f = reinterpret_cast<const uint64_t*>(buffer + mavh.MemSz());
-    const auto pmav_u = reinterpret_cast<const uint64_t*>(buffer + mavh.MemSz() + mavh.MavSz());
-    for (size_t i = 0; i < free_segs.size(); ++i) {
-        const uint64_t* pmsh = pmav_f + i;
-        EXPECT_EQ(free_segs[i], MshT(*pmsh)) << "free " << i;
-    }
-    for (size_t i = 0; i < used_segs.size(); ++i) {
-        const uint64_t* pmsh = pmav_u - i - 1;
-        EXPECT_EQ(used_segs[i], MshT(*pmsh)) << "used " << i;
-    }
+    EXPECT_EQ(_linear_get_number_of_free_segment_headers(mavh.ToMavh(), buffer), free_segs.size());
+    EXPECT_EQ(_linear_get_number_of_used_segment_headers(mavh.ToMavh(), buffer), used_segs.size());
+    EXPECT_EQ(LinearUtils::FreeSegments(mavh, buffer), free_segs);
+    EXPECT_EQ(LinearUtils::UsedSegments(mavh, buffer), used_segs);
 }
 
 TEST_F(LinearTest, deallocate_manual) {
@@ -440,10 +535,6 @@ TEST_F(LinearTest, deallocate_manual) {
     }
 }
 
-bool OrderByOffset(const MshT& x, const MshT& y) {
-    return x.Offset() < y.Offset();
-}
-
 void InsertSorted(std::vector<MshT>& mshs, const MshT& msh) {
     auto after = std::lower_bound(mshs.begin(), mshs.end(), msh, OrderByOffset);
     mshs.insert(after, msh);
@@ -487,12 +578,10 @@ void IncreaseFreeSpace(std::vector<MshT>& mshs, const MshT& msh) {
 TEST_F(LinearTest, allocate_and_deallocate) {
     constexpr uint64_t mem_sz = 0x1'0000;
     constexpr uint64_t mav_sz = 0x1000;
-    const MavhT mavh0(mem_sz, mav_sz, 1, 0);
     const MshT msh0(0, mem_sz);
+    const auto mavh0 =
+          LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), _mem_pbase, { msh0 });
     _linear_mavh = mavh0.ToMavh();
-    uint64_t* const pmav_f = reinterpret_cast<uint64_t*>(_mem_pbase + mem_sz);
-    const uint64_t* pmav_u = reinterpret_cast<const uint64_t*>(_mem_pbase + mem_sz + mav_sz);
-    *pmav_f = msh0.ToMsh();
     std::vector<const void*> allocated;
     std::vector<MshT> used;
     std::vector<MshT> free = { msh0 };
@@ -530,18 +619,365 @@ TEST_F(LinearTest, allocate_and_deallocate) {
 
         // check the free and the used MSHs
         const MavhT mavh(_linear_mavh);
-        pmav_u = reinterpret_cast<const uint64_t*>(_mem_pbase + mavh.MemSz() + mavh.MavSz());
-        std::vector<MshT> mav_f, mav_u;
-        for (size_t i = 0; i < mavh.NumFree(); ++i) {
-            mav_f.emplace_back(*(pmav_f + i));
+        EXPECT_EQ(LinearUtils::FreeSegments(mavh, _mem_pbase), free) << mavh;
+        EXPECT_EQ(LinearUtils::UsedSegments(mavh, _mem_pbase), used) << mavh;
+        if (_linear_bins[0] == _linear_mavh) {
+            LinearUtils::CheckBins(__LINE__, _linear_bins, _mem_pbase, free);
         }
+    }
+}
 
-        for (size_t i = 0; i < mavh.NumUsed(); ++i) {
-            mav_u.emplace_back(*(pmav_u - i - 1));
+TEST_F(LinearTest, allocate_fragmented) {
+    MavhT mavh(_linear_mavh);
+    const VecSegsT used_segs = {
+        MshT(16, 16),
+        MshT(64, 64),
+        MshT(256, 256),
+        MshT(1024, 1024),
+    };
+    VecSegsT free_segs;
+    PrepareMemoryAllocation(mavh, _mem_pbase, free_segs, used_segs);
+    _linear_mavh = mavh.ToMavh();
+    // free segments: [0, 16) [32, 64) [128, 256) [512, 1024) [2048, mem_sz)
+
+    // the bins are built for the manually prepared MAV
+    const auto p1 = static_cast<uint8_t*>(linear_allocate(24));
+    EXPECT_EQ(_linear_bins[0], _linear_mavh);
+    EXPECT_EQ(p1, _mem_pbase + 64 - 24); // class 5 [32, 64) is the first class that fits
+    const VecSegsT free_segs1 = {
+        MshT(0, 16),
+        MshT(32, 8),
+        MshT(128, 128),
+        MshT(512, 512),
+        MshT(2048, mavh.MemSz() - 2048),
+    };
+    LinearUtils::CheckBins(__LINE__, _linear_bins, _mem_pbase, free_segs1);
+
+    const auto p2 = static_cast<uint8_t*>(linear_allocate(200));
+    EXPECT_EQ(p2, _mem_pbase + 1024 - 200); // class 9 [512, 1024)
+
+    const auto p3 = static_cast<uint8_t*>(linear_allocate(96));
+    EXPECT_EQ(p3, _mem_pbase + 256 - 96); // class 7 [128, 256)
+
+    EXPECT_EQ(linear_deallocate(p1), 0);
+    EXPECT_EQ(linear_deallocate(p2), 0);
+    EXPECT_EQ(linear_deallocate(p3), 0);
+    mavh = MavhT(_linear_mavh);
+    const VecSegsT expected_free = {
+        MshT(0, 16),
+        MshT(32, 32),
+        MshT(128, 128),
+        MshT(512, 512),
+        MshT(2048, mavh.MemSz() - 2048),
+    };
+    CheckMemoryAllocation(__LINE__, mavh, _mem_pbase, expected_free, used_segs);
+    LinearUtils::CheckBins(__LINE__, _linear_bins, _mem_pbase, expected_free);
+}
+
+TEST_F(LinearTest, reallocate) {
+    MavhT mavh(_linear_mavh);
+    const VecSegsT used_segs = {
+        MshT(16, 16),
+        MshT(64, 64),
+        MshT(256, 256),
+    };
+    VecSegsT free_segs;
+    PrepareMemoryAllocation(mavh, _mem_pbase, free_segs, used_segs);
+    _linear_mavh = mavh.ToMavh();
+    // free segments: [0, 16) [32, 64) [128, 256) [512, mem_sz)
+    const auto p = _mem_pbase + 16;
+    std::fill_n(p, 16, 'a');
+
+    // grows into the free block after it
+    EXPECT_EQ(linear_reallocate(p, 35), p);
+    CheckMemoryAllocation(__LINE__,
+          MavhT(_linear_mavh),
+          _mem_pbase,
+          { MshT(0, 16), MshT(56, 8), MshT(128, 128), MshT(512, mavh.MemSz() - 512) },
+          { MshT(16, 40), MshT(64, 64), MshT(256, 256) });
+
+    // takes all the free block after it
+    EXPECT_EQ(linear_reallocate(p, 48), p);
+    CheckMemoryAllocation(__LINE__,
+          MavhT(_linear_mavh),
+          _mem_pbase,
+          { MshT(0, 16), MshT(128, 128), MshT(512, mavh.MemSz() - 512) },
+          { MshT(16, 48), MshT(64, 64), MshT(256, 256) });
+
+    // a used block is after it: it grows into the free block before it keeping its contents
+    const auto p2 = static_cast<uint8_t*>(linear_reallocate(p, 56));
+    EXPECT_EQ(p2, _mem_pbase + 8);
+    EXPECT_EQ(std::count(p2, p2 + 16, 'a'), 16);
+    CheckMemoryAllocation(__LINE__,
+          MavhT(_linear_mavh),
+          _mem_pbase,
+          { MshT(0, 8), MshT(128, 128), MshT(512, mavh.MemSz() - 512) },
+          { MshT(8, 56), MshT(64, 64), MshT(256, 256) });
+
+    // no room around it: it moves to class 7 [128, 256) keeping its contents
+    const auto p3 = static_cast<uint8_t*>(linear_reallocate(p2, 100));
+    EXPECT_EQ(p3, _mem_pbase + 256 - 104);
+    EXPECT_EQ(std::count(p3, p3 + 16, 'a'), 16);
+    CheckMemoryAllocation(__LINE__,
+          MavhT(_linear_mavh),
+          _mem_pbase,
+          { MshT(0, 64), MshT(128, 24), MshT(512, mavh.MemSz() - 512) },
+          { MshT(64, 64), MshT(152, 104), MshT(256, 256) });
+
+    // shrinks in place (the end joins the free block after it)
+    const auto p4 = _mem_pbase + 256;
+    EXPECT_EQ(linear_reallocate(p4, 100), p4);
+    CheckMemoryAllocation(__LINE__,
+          MavhT(_linear_mavh),
+          _mem_pbase,
+          { MshT(0, 64), MshT(128, 24), MshT(360, mavh.MemSz() - 360) },
+          { MshT(64, 64), MshT(152, 104), MshT(256, 104) });
+    LinearUtils::CheckBins(__LINE__,
+          _linear_bins,
+          _mem_pbase,
+          { MshT(0, 64), MshT(128, 24), MshT(360, mavh.MemSz() - 360) });
+
+    // same size
+    EXPECT_EQ(linear_reallocate(p4, 97), p4);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 3);
+
+    // null pointer allocates and size 0 deallocates
+    const auto p5 = linear_reallocate(nullptr, 8);
+    ASSERT_NE(p5, nullptr);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 4);
+    EXPECT_EQ(linear_reallocate(p5, 0), nullptr);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 3);
+
+    // not allocated
+    EXPECT_EQ(linear_reallocate(_mem_pbase + 8, 8), nullptr);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 3);
+}
+
+TEST_F(LinearTest, allocate_aligned) {
+    const MavhT mavh0(_linear_mavh);
+    std::vector<std::pair<uint8_t*, uint64_t>> ptrs;
+    for (uint64_t alignment = 16; alignment <= 4096; alignment *= 2) {
+        for (const uint64_t size : { 8, 40, 1000 }) {
+            SCOPED_TRACE(
+                  "alignment " + std::to_string(alignment) + " size " + std::to_string(size));
+            const auto ptr = static_cast<uint8_t*>(linear_allocate_aligned(size, alignment));
+            ASSERT_NE(ptr, nullptr);
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignment, 0);
+            std::fill_n(ptr, size, 'a');
+            ptrs.emplace_back(ptr, size);
+
+            // the block is used and the padding around it is free (no block is lost)
+            const MavhT mavh(_linear_mavh);
+            const auto free_segs = LinearUtils::FreeSegments(mavh, _mem_pbase);
+            const auto used_segs = LinearUtils::UsedSegments(mavh, _mem_pbase);
+            EXPECT_NE(std::find(used_segs.begin(), used_segs.end(), MshT(ptr - _mem_pbase, size)),
+                  used_segs.end());
+            VecSegsT segs = free_segs;
+            segs.insert(segs.end(), used_segs.begin(), used_segs.end());
+            std::sort(segs.begin(), segs.end(), OrderByOffset);
+            EXPECT_EQ(segs.front().Offset(), 0);
+            EXPECT_EQ(segs.back().Offset() + segs.back().Size(), mavh.MemSz());
+            for (size_t i = 1; i < segs.size(); ++i) {
+                EXPECT_TRUE(segs[i - 1].FollowedBy(segs[i])) << segs[i - 1] << " " << segs[i];
+            }
+        }
+    }
+
+    // no block overwrote another
+    for (const auto& [ptr, size] : ptrs) {
+        EXPECT_EQ(std::count(ptr, ptr + size, 'a'), static_cast<std::ptrdiff_t>(size));
+    }
+
+    // alignments up to 8 allocate as linear_allocate
+    const auto ptr = linear_allocate_aligned(24, 8);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+
+    // the blocks are deallocated as any other and the padding joins back
+    for (const auto& [ptr, size] : ptrs) {
+        EXPECT_EQ(linear_deallocate(ptr), 0);
+    }
+    CheckMemoryAllocation(__LINE__,
+          MavhT(_linear_mavh),
+          _mem_pbase,
+          { MshT(0, mavh0.MemSz()) },
+          {});
+
+    EXPECT_EQ(linear_allocate_aligned(0, 64), nullptr);
+}
+
+TEST_F(LinearTest, allocate_and_deallocate_batch) {
+    const MavhT mavh0(_linear_mavh);
+    const uint64_t mem_sz = mavh0.MemSz();
+
+    // the blocks are taken one after the other from the end of the same free block
+    const std::vector<uint64_t> sizes = { 8, 0, 20, 100 };
+    std::vector<void*> ptrs(sizes.size());
+    EXPECT_EQ(linear_allocate_batch(sizes.data(), sizes.size(), ptrs.data()), 0);
+    EXPECT_EQ(ptrs[0], _mem_pbase + mem_sz - 8);
+    EXPECT_EQ(ptrs[1], nullptr);
+    EXPECT_EQ(ptrs[2], _mem_pbase + mem_sz - 32);
+    EXPECT_EQ(ptrs[3], _mem_pbase + mem_sz - 136);
+    CheckMemoryAllocation(__LINE__,
+          MavhT(_linear_mavh),
+          _mem_pbase,
+          { MshT(0, mem_sz - 136) },
+          { MshT(mem_sz - 136, 104), MshT(mem_sz - 32, 24), MshT(mem_sz - 8, 8) });
+    LinearUtils::CheckBins(__LINE__, _linear_bins, _mem_pbase, { MshT(0, mem_sz - 136) });
+
+    // a block in the middle, then the others (they join in a run, null pointers are skipped)
+    EXPECT_EQ(linear_deallocate_batch(&ptrs[2], 1), 0);
+    CheckMemoryAllocation(__LINE__,
+          MavhT(_linear_mavh),
+          _mem_pbase,
+          { MshT(0, mem_sz - 136), MshT(mem_sz - 32, 24) },
+          { MshT(mem_sz - 136, 104), MshT(mem_sz - 8, 8) });
+    const std::vector<void*> rest = { ptrs[3], nullptr, ptrs[0] };
+    EXPECT_EQ(linear_deallocate_batch(rest.data(), rest.size()), 0);
+    CheckMemoryAllocation(__LINE__, MavhT(_linear_mavh), _mem_pbase, { MshT(0, mem_sz) }, {});
+
+    // pointers not allocated are skipped
+    const auto ptr = linear_allocate(8);
+    const std::vector<void*> bad = { _mem_pbase + 8, ptr, ptr };
+    EXPECT_EQ(linear_deallocate_batch(bad.data(), bad.size()), -EINVAL);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+
+    // the blocks that do not fit are not allocated
+    const std::vector<uint64_t> big = { mem_sz / 2, mem_sz, 8 };
+    EXPECT_EQ(linear_allocate_batch(big.data(), big.size(), ptrs.data()), -ENOMEM);
+    EXPECT_NE(ptrs[0], nullptr);
+    EXPECT_EQ(ptrs[1], nullptr);
+    EXPECT_NE(ptrs[2], nullptr);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1); // the lower 26 bits of 2^26 + 1
+}
+
+TEST_F(LinearTest, allocate_and_deallocate_batch_random) {
+    const MavhT mavh0(_linear_mavh);
+    std::mt19937 gen(12);
+    std::uniform_int_distribution<uint64_t> dist_size(1, 300);
+    std::vector<void*> live;
+    for (int i = 0; i < 50; ++i) {
+        std::vector<uint64_t> sizes(1 + gen() % 100);
+        for (auto& size : sizes) {
+            size = dist_size(gen);
+        }
+        std::vector<void*> ptrs(sizes.size());
+        ASSERT_EQ(linear_allocate_batch(sizes.data(), sizes.size(), ptrs.data()), 0);
+        for (size_t j = 0; j < ptrs.size(); ++j) {
+            std::fill_n(static_cast<char*>(ptrs[j]), sizes[j], 'a');
         }
-        EXPECT_EQ(mav_f, free) << mavh;
-        EXPECT_EQ(mav_u, used) << mavh;
+        live.insert(live.end(), ptrs.begin(), ptrs.end());
+
+        // some blocks go back in a random order
+        std::shuffle(live.begin(), live.end(), gen);
+        const auto n = live.size() / 3;
+        ASSERT_EQ(linear_deallocate_batch(live.data() + live.size() - n, n), 0);
+        live.resize(live.size() - n);
+        ASSERT_EQ(MavhT(_linear_mavh).NumUsed(), live.size());
     }
+    ASSERT_EQ(linear_deallocate_batch(live.data(), live.size()), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).NumFree(), 1);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).MemSz(), mavh0.MemSz());
+}
+
+TEST_F(LinearTest, stats) {
+    const uint64_t mem_sz = MavhT(_linear_mavh).MemSz();
+    linear_statistics stats;
+    EXPECT_EQ(linear_stats(&stats), 0);
+    EXPECT_EQ(stats.memory_size, mem_sz);
+    EXPECT_EQ(stats.mav_size, 4096);
+    EXPECT_EQ(stats.used_bytes, 0);
+    EXPECT_EQ(stats.free_bytes, mem_sz);
+    EXPECT_EQ(stats.peak_used_bytes, 0);
+    EXPECT_EQ(stats.largest_free_block, mem_sz);
+    EXPECT_EQ(stats.fragmentation, 0);
+    EXPECT_EQ(stats.used_blocks, 0);
+    EXPECT_EQ(stats.free_blocks, 1);
+    EXPECT_EQ(stats.free_blocks_by_class[_linear_size_class(mem_sz)], 1);
+
+    // free blocks: [0, mem_sz - 3072) [mem_sz - 1024, mem_sz)
+    const auto p1 = linear_allocate(1024);
+    const auto p2 = linear_allocate(1024);
+    const auto p3 = linear_allocate(1024);
+    EXPECT_EQ(linear_deallocate(p1), 0);
+    EXPECT_EQ(linear_stats(&stats), 0);
+    EXPECT_EQ(stats.used_bytes, 2048);
+    EXPECT_EQ(stats.free_bytes, mem_sz - 2048);
+    EXPECT_EQ(stats.peak_used_bytes, 3072);
+    EXPECT_EQ(stats.largest_free_block, mem_sz - 3072);
+    EXPECT_EQ(stats.fragmentation, 1024 * 1'000'000 / (mem_sz - 2048));
+    EXPECT_EQ(stats.used_blocks, 2);
+    EXPECT_EQ(stats.free_blocks, 2);
+    EXPECT_EQ(stats.free_blocks_by_class[10], 1);
+    EXPECT_EQ(stats.free_blocks_by_class[_linear_size_class(mem_sz - 3072)], 1);
+
+    EXPECT_EQ(linear_deallocate(p2), 0);
+    EXPECT_EQ(linear_deallocate(p3), 0);
+    EXPECT_EQ(linear_stats(&stats), 0);
+    EXPECT_EQ(stats.used_bytes, 0);
+    EXPECT_EQ(stats.peak_used_bytes, 3072);
+    EXPECT_EQ(stats.fragmentation, 0);
+
+    // not initialized
+    linear_deinit();
+    EXPECT_EQ(linear_stats(&stats), -EINVAL);
+}
+
+TEST_F(LinearTest, stats_beyond_26_bits) {
+    // the pool as if it had 2^26 - 1 used blocks besides the one allocated
+    constexpr uint64_t limit = uint64_t(1) << 26;
+    const auto p1 = linear_allocate(64);
+    ASSERT_NE(p1, nullptr);
+    const MavhT mavh0(_linear_mavh);
+    LinearUtils::SegmentCounts(mavh0, _mem_pbase)[1] += limit - 1;
+    _linear_mavh = MavhT(mavh0.MemSz(), mavh0.MavSz(), mavh0.NumFree(), 0).ToMavh();
+
+    const auto p2 = linear_allocate(64);
+    ASSERT_NE(p2, nullptr);
+    linear_statistics stats;
+    EXPECT_EQ(linear_stats(&stats), 0);
+    EXPECT_EQ(stats.used_blocks, limit + 1);
+    EXPECT_EQ(stats.free_blocks, 1);
+    EXPECT_EQ(stats.used_bytes, 128);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1); // the lower 26 bits of 2^26 + 1
+
+    EXPECT_EQ(linear_deallocate(p1), 0);
+    EXPECT_EQ(linear_deallocate(p2), 0);
+    EXPECT_EQ(linear_stats(&stats), 0);
+    EXPECT_EQ(stats.used_blocks, limit - 1);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), limit - 1);
+}
+
+TEST_F(LinearTest, stats_largest_free_block_allocated) {
+    // 20 free blocks of 3000 bytes and one of 4000 bytes (all of size class 11) before the tail
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 20; ++i) {
+        ptrs.push_back(linear_allocate(3000));
+        ptrs.push_back(linear_allocate(8));
+    }
+    ptrs.push_back(linear_allocate(4000));
+    ptrs.push_back(linear_allocate(8));
+    for (size_t i = 0; i < ptrs.size(); i += 2) {
+        ASSERT_EQ(linear_deallocate(ptrs[i]), 0);
+    }
+    linear_statistics stats;
+    ASSERT_EQ(linear_stats(&stats), 0);
+    const uint64_t tail = stats.largest_free_block;
+    EXPECT_EQ(tail, stats.free_bytes - 20 * 3000 - 4000);
+
+    // the tail goes: the largest block of class 11 is searched
+    ASSERT_NE(linear_allocate(tail), nullptr);
+    ASSERT_EQ(linear_stats(&stats), 0);
+    EXPECT_EQ(stats.free_blocks_by_class[11], 21);
+    EXPECT_EQ(stats.largest_free_block, 4000);
+    EXPECT_EQ(stats.fragmentation, 20 * 3000 * 1'000'000ull / (20 * 3000 + 4000));
+
+    // the block of 4000 bytes goes: more than 16 blocks are left, any of them is the largest
+    ASSERT_NE(linear_allocate(4000), nullptr);
+    ASSERT_EQ(linear_stats(&stats), 0);
+    EXPECT_EQ(stats.free_blocks_by_class[11], 20);
+    EXPECT_EQ(stats.largest_free_block, 3000);
 }
 
 TEST_F(LinearTest, get_mav_size) {
@@ -581,72 +1017,118 @@ TEST_F(LinearTest, get_memory_size) {
 }
 
 TEST_F(LinearTest, get_number_of_free_segment_headers) {
-    // 26 bits (26-51)
-    EXPECT_EQ(_linear_get_number_of_free_segment_headers(0x0000'0000'0000'0000), 0);
-    EXPECT_EQ(_linear_get_number_of_free_segment_headers(0x0000'0000'0400'0000), 1);
-    EXPECT_EQ(_linear_get_number_of_free_segment_headers(0x0000'0000'0800'0000), 2);
-    EXPECT_EQ(_linear_get_number_of_free_segment_headers(0x0000'000f'fc00'0000), 1023);
-    EXPECT_EQ(_linear_get_number_of_free_segment_headers(0x0000'00ff'fc00'0000), 16'383);
-    EXPECT_EQ(_linear_get_number_of_free_segment_headers(0x0000'0fff'fc00'0000), 262'143);
-    EXPECT_EQ(_linear_get_number_of_free_segment_headers(0x0000'ffff'fc00'0000), 4'194'303);
-    EXPECT_EQ(
-          _linear_get_number_of_free_segment_headers(0x000f'ffff'fc00'0000),
-          67'108'863); // maximum
-    for (uint64_t bits = 1; bits <= 26; ++bits) {
-        uint64_t mavh = Utils::RandomValue<uint64_t>();
-        mavh &= 0xfff0'0000'03ff'ffff;
-        const uint64_t size = (uint64_t(1) << bits) - 1;
-        mavh |= size << 26;
-        EXPECT_EQ(_linear_get_number_of_free_segment_headers(mavh), size)
-              << LinearUtils::MavhToString(mavh);
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x4000;
+    BufferT buffer(mem_sz + mav_sz, 0);
+    VecSegsT segs;
+    for (uint64_t i = 0; i < 300; ++i) {
+        segs.emplace_back(i * 64, 32);
     }
+    const auto mavh =
+          LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer.data(), segs);
+    EXPECT_EQ(_linear_get_number_of_free_segment_headers(mavh.ToMavh(), buffer.data()), 300);
+    EXPECT_EQ(_linear_get_number_of_used_segment_headers(mavh.ToMavh(), buffer.data()), 0);
+
+    auto pmsh = _linear_free_msh_at(mavh.ToMavh(), buffer.data(), 100);
+    const auto mavh1 = _linear_remove_free_msh(mavh.ToMavh(), buffer.data(), pmsh);
+    EXPECT_EQ(_linear_get_number_of_free_segment_headers(mavh1, buffer.data()), 299);
+    EXPECT_EQ(MavhT(mavh1).NumFree(), 299);
 }
 
 TEST_F(LinearTest, get_number_of_used_segment_headers) {
-    // 26 bits (0-25)
-    EXPECT_EQ(_linear_get_number_of_used_segment_headers(0x0000'0000'0000'0000), 0);
-    EXPECT_EQ(_linear_get_number_of_used_segment_headers(0x0000'0000'0000'000f), 15);
-    EXPECT_EQ(_linear_get_number_of_used_segment_headers(0x0000'0000'0000'00ff), 255);
-    EXPECT_EQ(_linear_get_number_of_used_segment_headers(0x0000'0000'0000'0fff), 4'095);
-    EXPECT_EQ(_linear_get_number_of_used_segment_headers(0x0000'0000'0000'ffff), 65'535);
-    EXPECT_EQ(_linear_get_number_of_used_segment_headers(0x0000'0000'000f'ffff), 1'048'575);
-    EXPECT_EQ(_linear_get_number_of_used_segment_headers(0x0000'0000'00ff'ffff), 16'777'215);
-    // maximum
-    EXPECT_EQ(_linear_get_number_of_used_segment_headers(0x0000'0000'03ff'ffff), 67'108'863);
-    for (uint64_t bits = 1; bits <= 26; ++bits) {
-        uint64_t mavh = Utils::RandomValue<uint64_t>();
-        mavh &= 0xffff'ffff'fc00'0000;
-        const uint64_t size = (uint64_t(1) << bits) - 1;
-        mavh |= size;
-        EXPECT_EQ(_linear_get_number_of_used_segment_headers(mavh), size)
-              << LinearUtils::MavhToString(mavh);
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x4000;
+    BufferT buffer(mem_sz + mav_sz, 0);
+    VecSegsT segs;
+    for (uint64_t i = 0; i < 300; ++i) {
+        segs.emplace_back(i * 64, 32);
     }
+    const auto mavh =
+          LinearUtils::PrepareUsedSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer.data(), segs);
+    EXPECT_EQ(_linear_get_number_of_used_segment_headers(mavh.ToMavh(), buffer.data()), 300);
+    EXPECT_EQ(_linear_get_number_of_free_segment_headers(mavh.ToMavh(), buffer.data()), 0);
+
+    auto pmsh = _linear_used_msh_at(mavh.ToMavh(), buffer.data(), 100);
+    const auto mavh1 = _linear_remove_used_msh(mavh.ToMavh(), buffer.data(), pmsh);
+    EXPECT_EQ(_linear_get_number_of_used_segment_headers(mavh1, buffer.data()), 299);
+    EXPECT_EQ(MavhT(mavh1).NumUsed(), 299);
+}
+
+TEST_F(LinearTest, number_of_segment_headers_beyond_26_bits) {
+    // MAV as if it had 2^26 - 1 free and 2^26 - 1 used MSHs: the MAVH has the lower 26 bits of
+    // the counts and the directory has all of them
+    constexpr uint64_t limit = uint64_t(1) << 26;
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x4000;
+    BufferT buffer(mem_sz + mav_sz, 0);
+    auto mavh = LinearUtils::PrepareSegments(
+          MavhT(mem_sz, mav_sz, 0, 0), buffer.data(), { MshT(0, 64) }, { MshT(64, 64) });
+    auto counts = LinearUtils::SegmentCounts(mavh, buffer.data());
+    counts[0] = limit - 1;
+    counts[1] = limit - 1;
+    auto mavh0 = MavhT(mem_sz, mav_sz, limit - 1, limit - 1).ToMavh();
+
+    const auto mavh1 = _linear_put_free_msh(mavh0, buffer.data(), MshT(256, 64).ToMsh());
+    const auto mavh2 = _linear_insert_used_msh(mavh1, buffer.data(), MshT(128, 64).ToMsh());
+    EXPECT_EQ(_linear_get_number_of_free_segment_headers(mavh2, buffer.data()), limit);
+    EXPECT_EQ(_linear_get_number_of_used_segment_headers(mavh2, buffer.data()), limit);
+    EXPECT_EQ(MavhT(mavh2), MavhT(mem_sz, mav_sz, 0, 0));
+
+    const auto mavh3 = _linear_insert_used_msh(mavh2, buffer.data(), MshT(192, 64).ToMsh());
+    EXPECT_EQ(_linear_get_number_of_used_segment_headers(mavh3, buffer.data()), limit + 1);
+    EXPECT_EQ(MavhT(mavh3).NumUsed(), 1);
+
+    const auto mavh4 = _linear_remove_used_msh(
+          mavh3, buffer.data(), _linear_used_msh_at(mavh3, buffer.data(), 0));
+    const auto mavh5 = _linear_remove_used_msh(
+          mavh4, buffer.data(), _linear_used_msh_at(mavh4, buffer.data(), 0));
+    EXPECT_EQ(_linear_get_number_of_used_segment_headers(mavh5, buffer.data()), limit - 1);
+    EXPECT_EQ(MavhT(mavh5).NumUsed(), limit - 1);
 }
 
 TEST_F(LinearTest, set_mavh) {
     EXPECT_EQ(_linear_set_mavh(0x1000'0000, 0x1000, 2, 3), 0x70c0'0000'0800'0003);
+
+    // the counts wrap without touching the other fields
+    constexpr uint64_t wrap = uint64_t(1) << 26;
+    EXPECT_EQ(_linear_set_mavh(0x1000'0000, 0x1000, wrap + 2, wrap + 3), 0x70c0'0000'0800'0003);
+}
+
+TEST_F(LinearTest, get_msh_unit) {
+    constexpr uint64_t GB = uint64_t(1) << 30;
+    EXPECT_EQ(_linear_get_msh_unit(_linear_set_mavh(0x1000, 0x1000, 0, 0)), 3);
+    EXPECT_EQ(_linear_get_msh_unit(_linear_set_mavh(16 * GB, 0x1000, 0, 0)), 3);
+    EXPECT_EQ(_linear_get_msh_unit(_linear_set_mavh(32 * GB, 0x1000, 0, 0)), 4);
+    EXPECT_EQ(_linear_get_msh_unit(_linear_set_mavh(64 * GB, 0x1000, 0, 0)), 5);
 }
 
 TEST_F(LinearTest, set_segment_header) {
-    EXPECT_EQ(_linear_set_msh(0x4'1234'5678, 0x4'9876'5438), 0x8246'8acf'930e'ca87);
+    const auto mavh = _linear_set_mavh(0x1000'0000, 0x1000, 0, 0);
+    EXPECT_EQ(_linear_set_msh(0x4'1234'5678, 0x4'9876'5438, mavh), 0x8246'8acf'930e'ca87);
 
     // maximum
-    EXPECT_EQ(_linear_set_msh(0x7'ffff'fff8, 0x7'ffff'fff8), 0xffff'ffff'ffff'ffff);
+    EXPECT_EQ(_linear_set_msh(0x7'ffff'fff8, 0x7'ffff'fff8, mavh), 0xffff'ffff'ffff'ffff);
 
     // maximum cleaning unused bits
-    EXPECT_EQ(_linear_set_msh(0xf'ffff'ffff, 0xf'ffff'ffff), 0xffff'ffff'ffff'ffff);
+    EXPECT_EQ(_linear_set_msh(0xf'ffff'ffff, 0xf'ffff'ffff, mavh), 0xffff'ffff'ffff'ffff);
+
+    // 16 bytes units above 16 GB
+    const auto wide = _linear_set_mavh(uint64_t(1) << 35, 0x1000, 0, 0);
+    EXPECT_EQ(_linear_set_msh(0x8'1234'5670, 0x4'9876'5430, wide), 0x8123'4567'4987'6543);
 }
 
 TEST_F(LinearTest, reduce_free_space) {
     constexpr uint64_t offset = 0xfff230;
     constexpr uint64_t size = 0xfff10;
-    const auto msh0 = _linear_set_msh(offset, size);
-    EXPECT_EQ(_linear_reduce_free_space(msh0, 16), _linear_set_msh(offset, size - 16));
-    EXPECT_EQ(_linear_reduce_free_space(msh0, 160), _linear_set_msh(offset, size - 160));
+    const auto mavh = _linear_set_mavh(0x1000'0000, 0x1000, 0, 0);
+    const auto msh0 = _linear_set_msh(offset, size, mavh);
+    EXPECT_EQ(_linear_reduce_free_space(msh0, 16, mavh), _linear_set_msh(offset, size - 16, mavh));
+    EXPECT_EQ(
+          _linear_reduce_free_space(msh0, 160, mavh), _linear_set_msh(offset, size - 160, mavh));
     for (uint64_t sz = 24; sz <= size; sz += 16) {
         SCOPED_TRACE("for size " + std::to_string(sz));
-        const auto reduced = _linear_reduce_free_space(msh0, sz);
-        const auto expected = _linear_set_msh(offset, size - sz);
+        const auto reduced = _linear_reduce_free_space(msh0, sz, mavh);
+        const auto expected = _linear_set_msh(offset, size - sz, mavh);
         EXPECT_EQ(MshT(reduced), MshT(expected));
     }
 }
@@ -655,7 +1137,7 @@ TEST_F(LinearTest, find_free_segment) {
     const MavhT mavh(_linear_mavh);
     EXPECT_EQ(
           _linear_find_free_msh(_linear_mavh, _mem_pbase, 256),
-          reinterpret_cast<uint64_t*>(_mem_pbase + mavh.MemSz()));
+          _linear_free_msh_at(_linear_mavh, _mem_pbase, 0));
     EXPECT_EQ(_linear_find_free_msh(_linear_mavh, _mem_pbase, effective_pool_size_ + 8), nullptr);
 }
 
@@ -663,22 +1145,35 @@ TEST_F(LinearTest, find_free_segment_manual_buffer) {
     constexpr uint64_t mem_sz = 0x8'0000;
     constexpr uint64_t mav_sz = 0x1000;
     uint8_t buffer[mem_sz + mav_sz];
-    uint64_t* const pmav_f = reinterpret_cast<uint64_t*>(buffer + mem_sz);
     const VecSegsT segs = {
         MshT(0, 16),
         MshT(128, 32),
         MshT(256, 64),
         MshT(1024, 512),
     };
-    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), pmav_f, segs);
-
-    EXPECT_EQ(_linear_find_free_msh(mavh.ToMavh(), buffer, 8), pmav_f + 0);
-    EXPECT_EQ(_linear_find_free_msh(mavh.ToMavh(), buffer, 16), pmav_f + 0);
-    EXPECT_EQ(_linear_find_free_msh(mavh.ToMavh(), buffer, 24), pmav_f + 1);
-    EXPECT_EQ(_linear_find_free_msh(mavh.ToMavh(), buffer, 32), pmav_f + 1);
-    EXPECT_EQ(_linear_find_free_msh(mavh.ToMavh(), buffer, 40), pmav_f + 2);
-    EXPECT_EQ(_linear_find_free_msh(mavh.ToMavh(), buffer, 64), pmav_f + 2);
-    EXPECT_EQ(_linear_find_free_msh(mavh.ToMavh(), buffer, 512), pmav_f + 3);
+    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
+
+    EXPECT_EQ(
+          _linear_find_free_msh(mavh.ToMavh(), buffer, 8),
+          _linear_free_msh_at(mavh.ToMavh(), buffer, 0));
+    EXPECT_EQ(
+          _linear_find_free_msh(mavh.ToMavh(), buffer, 16),
+          _linear_free_msh_at(mavh.ToMavh(), buffer, 0));
+    EXPECT_EQ(
+          _linear_find_free_msh(mavh.ToMavh(), buffer, 24),
+          _linear_free_msh_at(mavh.ToMavh(), buffer, 1));
+    EXPECT_EQ(
+          _linear_find_free_msh(mavh.ToMavh(), buffer, 32),
+          _linear_free_msh_at(mavh.ToMavh(), buffer, 1));
+    EXPECT_EQ(
+          _linear_find_free_msh(mavh.ToMavh(), buffer, 40),
+          _linear_free_msh_at(mavh.ToMavh(), buffer, 2));
+    EXPECT_EQ(
+          _linear_find_free_msh(mavh.ToMavh(), buffer, 64),
+          _linear_free_msh_at(mavh.ToMavh(), buffer, 2));
+    EXPECT_EQ(
+          _linear_find_free_msh(mavh.ToMavh(), buffer, 512),
+          _linear_free_msh_at(mavh.ToMavh(), buffer, 3));
     EXPECT_EQ(_linear_find_free_msh(mavh.ToMavh(), buffer, 520), nullptr);
     for (uint64_t sz = 8; sz <= 512; sz += 8) {
         auto index = [&segs](const uint64_t size) -> size_t {
@@ -689,7 +1184,9 @@ TEST_F(LinearTest, find_free_segment_manual_buffer) {
             }
             return segs.size();
         };
-        EXPECT_EQ(_linear_find_free_msh(mavh.ToMavh(), buffer, sz), pmav_f + index(sz));
+        EXPECT_EQ(
+              _linear_find_free_msh(mavh.ToMavh(), buffer, sz),
+              _linear_free_msh_at(mavh.ToMavh(), buffer, index(sz)));
     }
 }
 
@@ -704,19 +1201,18 @@ TEST_F(LinearTest, find_used_segment_manual_buffer) {
     constexpr uint64_t mem_sz = 0x8'0000;
     constexpr uint64_t mav_sz = 0x1000;
     uint8_t buffer[mem_sz + mav_sz];
-    uint64_t* const pmav_u = reinterpret_cast<uint64_t*>(buffer + mem_sz + mav_sz);
     const VecSegsT segs = {
         MshT(0, 16),
         MshT(128, 32),
         MshT(256, 64),
         MshT(1024, 512),
     };
-    const auto mavh = LinearUtils::PrepareUsedSegments(MavhT(mem_sz, mav_sz, 0, 0), pmav_u, segs);
+    const auto mavh = LinearUtils::PrepareUsedSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
     for (size_t i = 0; i < segs.size(); ++i) {
         SCOPED_TRACE("Seg = " + segs[i].ToString());
         EXPECT_EQ(
               _linear_find_used_msh(mavh.ToMavh(), buffer, buffer + segs[i].Offset()),
-              pmav_u - i);
+              _linear_used_msh_at(mavh.ToMavh(), buffer, i));
     }
     // try address that don't match
     for (const auto& seg : segs) {
@@ -734,7 +1230,6 @@ TEST_F(LinearTest, find_index_new_free_segment_manual_buffer) {
     constexpr uint64_t mem_sz = 0x8'0000;
     constexpr uint64_t mav_sz = 0x1000;
     uint8_t buffer[mem_sz + mav_sz];
-    const auto pmav_f = reinterpret_cast<uint64_t*>(buffer + mem_sz);
 
     VecSegsT segs = {
         MshT(0, 64),
@@ -742,7 +1237,7 @@ TEST_F(LinearTest, find_index_new_free_segment_manual_buffer) {
         MshT(1024, 32),
         MshT(1064, 64),
     };
-    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), pmav_f, segs);
+    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
     EXPECT_EQ(_linear_find_index_new_free_msh(mavh.ToMavh(), buffer, 4096), segs.size());
     uint64_t expected_msh = 0;
     for (uint64_t offset = 0; offset < 1600; offset += 8) {
@@ -762,6 +1257,7 @@ TEST_F(LinearTest, find_index_new_free_segment_manual_buffer_no_free_segments) {
     constexpr uint64_t mav_sz = 0x1000;
     uint8_t buffer[mem_sz + mav_sz];
     const auto mavh = _linear_set_mavh(mem_sz, mav_sz, 0, 0);
+    _linear_mav_init(mavh, buffer);
     for (uint64_t offset = 0; offset < 1600; offset += 8) {
         SCOPED_TRACE("offset = " + std::to_string(offset));
         EXPECT_EQ(_linear_find_index_new_free_msh(mavh, buffer, offset), 0);
@@ -769,27 +1265,24 @@ TEST_F(LinearTest, find_index_new_free_segment_manual_buffer_no_free_segments) {
 }
 
 TEST_F(LinearTest, find_position_new_used_segment) {
-    const MavhT mavh(_linear_mavh);
-    EXPECT_EQ(
-          _linear_find_position_new_used_msh(_linear_mavh, _mem_pbase, 0),
-          reinterpret_cast<uint64_t*>(_mem_pbase + mavh.MemSz() + mavh.MavSz()));
+    // no used MSHs: the new one goes at the end
+    EXPECT_EQ(_linear_find_position_new_used_msh(_linear_mavh, _mem_pbase, 0), nullptr);
 }
 
 TEST_F(LinearTest, find_position_new_used_segment_manual_buffer) {
     constexpr uint64_t mem_sz = 0x8'0000;
     constexpr uint64_t mav_sz = 0x1000;
     uint8_t buffer[mem_sz + mav_sz];
-    const auto pmav_u = reinterpret_cast<uint64_t*>(buffer + mem_sz + mav_sz);
     VecSegsT segs = {
         MshT(512, 16),
         MshT(1024, 32),
         MshT(1064, 64),
         MshT(2048, 512),
     };
-    const auto mavh = LinearUtils::PrepareUsedSegments(MavhT(mem_sz, mav_sz, 0, 0), pmav_u, segs);
+    const auto mavh = LinearUtils::PrepareUsedSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
     EXPECT_EQ(
           _linear_find_position_new_used_msh(mavh.ToMavh(), buffer, 4096),
-          pmav_u - segs.size());
+          nullptr);
     uint64_t expected_msh = 0;
     for (uint64_t offset = 0; offset < 2560; offset += 8) {
         SCOPED_TRACE(
@@ -801,7 +1294,7 @@ TEST_F(LinearTest, find_position_new_used_segment_manual_buffer) {
         }
         EXPECT_EQ(
               _linear_find_position_new_used_msh(mavh.ToMavh(), buffer, offset),
-              pmav_u - expected_msh);
+              _linear_used_msh_at(mavh.ToMavh(), buffer, expected_msh));
     }
 }
 
@@ -815,22 +1308,15 @@ void CheckLinearInsertFreeSegment(
     SCOPED_TRACE("From line " + std::to_string(line));
     const auto full_sz = mem_sz + mav_sz;
     BufferT buffer(full_sz, 0);
-    const auto pmav_f = reinterpret_cast<uint64_t*>(buffer.data() + mem_sz);
 
     const auto mavh =
-          LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), pmav_f, segs_before);
+          LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer.data(), segs_before);
 
     // check initial situation of buffer
     for (size_t i = 0; i < mem_sz; ++i) {
         EXPECT_EQ(buffer[i], 0) << "offset " << i;
     }
-    for (size_t i = segs_before.size() * 8; i < mav_sz; ++i) {
-        EXPECT_EQ(buffer[mem_sz + i], 0) << "offset " << i;
-    }
-    for (size_t i = 0; i < segs_before.size(); ++i) {
-        const auto sh = pmav_f[i];
-        EXPECT_EQ(MshT(sh), MshT(segs_before[i])) << "offset " << i;
-    }
+    EXPECT_EQ(LinearUtils::FreeSegments(mavh, buffer.data()), segs_before);
 
     // make the change
     const auto new_mavh = _linear_insert_free_msh(mavh.ToMavh(), buffer.data(), msh.ToMsh());
@@ -841,13 +1327,7 @@ void CheckLinearInsertFreeSegment(
     for (size_t i = 0; i < mem_sz; ++i) {
         EXPECT_EQ(buffer[i], 0) << "offset " << i;
     }
-    for (size_t i = std::max(segs_before.size(), segs_after.size()) * 8; i < mav_sz; ++i) {
-        EXPECT_EQ(buffer[mem_sz + i], 0) << "offset " << i;
-    }
-    for (size_t i = 0; i < segs_after.size(); ++i) {
-        const auto sh = pmav_f[i];
-        EXPECT_EQ(MshT(sh), MshT(segs_after[i])) << "idx " << i;
-    }
+    EXPECT_EQ(LinearUtils::FreeSegments(MavhT(new_mavh), buffer.data()), segs_after);
 }
 
 TEST_F(LinearTest, insert_free_segment) {
@@ -913,32 +1393,25 @@ void CheckLinearInsertUsedSegment(
     std::generate(buffer.begin(), buffer.end(), []() { return Utils::RandomValue<uint8_t>(); });
     const auto buffer0 = buffer; // save a copy
 
-    const auto pmav_u = reinterpret_cast<uint64_t*>(buffer.data() + full_sz);
-
-    const auto mavh = LinearUtils::PrepareUsedSegments(MavhT(mem_sz, mav_sz, 1, 0), pmav_u, segs);
+    const auto mavh =
+          LinearUtils::PrepareUsedSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer.data(), segs);
 
     // check initial situation of buffer
-    for (size_t i = 0; i < full_sz - 8 * segs.size(); ++i) {
+    for (size_t i = 0; i < mem_sz; ++i) {
         EXPECT_EQ(buffer[i], buffer0[i]) << i;
     }
-    for (size_t i = 0; i < segs.size(); ++i) {
-        const auto sh = *(pmav_u - (i + 1));
-        EXPECT_EQ(MshT(sh), segs[i]) << i;
-    }
+    EXPECT_EQ(LinearUtils::UsedSegments(mavh, buffer.data()), segs);
 
     // make the change
     const auto new_mavh = _linear_insert_used_msh(mavh.ToMavh(), buffer.data(), msh.ToMsh());
     segs.insert(segs.begin() + insert_idx, msh);
 
-    EXPECT_EQ(new_mavh, _linear_set_mavh(mem_sz, mav_sz, 1, segs.size()));
+    EXPECT_EQ(new_mavh, _linear_set_mavh(mem_sz, mav_sz, 0, segs.size()));
     // check buffer situation after change
-    for (size_t i = 0; i < full_sz - 8 * segs.size(); ++i) {
+    for (size_t i = 0; i < mem_sz; ++i) {
         EXPECT_EQ(buffer[i], buffer0[i]) << i;
     }
-    for (size_t i = 0; i < segs.size(); ++i) {
-        const auto sh = *(pmav_u - (i + 1));
-        EXPECT_EQ(MshT(sh), segs[i]) << i;
-    }
+    EXPECT_EQ(LinearUtils::UsedSegments(MavhT(new_mavh), buffer.data()), segs);
 }
 
 TEST_F(LinearTest, insert_used_segment) {
@@ -967,49 +1440,131 @@ TEST_F(LinearTest, remove_free_segment) {
     constexpr uint64_t NUM_FREE_SEGMENTS = 10;
     constexpr uint64_t IDX_REMOVE = 6;
     const MavhT mavh0(_linear_mavh);
-    // change mavh to get
-    _linear_mavh = _linear_set_mavh(mavh0.MemSz(), mavh0.MavSz(), NUM_FREE_SEGMENTS, 5);
-    // fill free segment headers with random bytes
-    auto pmav_f = _mem_pbase + mavh0.MemSz();
-    std::generate(pmav_f, pmav_f + mavh0.MavSz(), []() { return Utils::RandomValue<uint8_t>(); });
-    BufferT expected_mav;
-    std::copy_n(pmav_f, mavh0.MavSz(), std::back_inserter(expected_mav));
-    const auto begin = expected_mav.begin();
-    std::copy(begin + (IDX_REMOVE + 1) * 8, begin + NUM_FREE_SEGMENTS * 8, begin + IDX_REMOVE * 8);
-
-    const MavhT expected_mavh(mavh0.MemSz(), mavh0.MavSz(), NUM_FREE_SEGMENTS - 1, 5);
-    auto pmsh = reinterpret_cast<uint64_t*>(pmav_f + IDX_REMOVE * 8);
-    EXPECT_EQ(MavhT(_linear_remove_free_msh(_linear_mavh, _mem_pbase, pmsh)), expected_mavh);
-
-    for (size_t i = 0; i < expected_mav.size(); ++i) {
-        EXPECT_EQ(expected_mav[i], pmav_f[i]) << "for " << i;
+    VecSegsT segs;
+    for (uint64_t i = 0; i < NUM_FREE_SEGMENTS; ++i) {
+        segs.emplace_back(i * 64, 32);
     }
+    const auto mavh = LinearUtils::PrepareFreeSegments(mavh0, _mem_pbase, segs);
+    segs.erase(segs.begin() + IDX_REMOVE);
+
+    const MavhT expected_mavh(mavh0.MemSz(), mavh0.MavSz(), NUM_FREE_SEGMENTS - 1, 0);
+    auto pmsh = _linear_free_msh_at(mavh.ToMavh(), _mem_pbase, IDX_REMOVE);
+    const MavhT mavh1(_linear_remove_free_msh(mavh.ToMavh(), _mem_pbase, pmsh));
+    EXPECT_EQ(mavh1, expected_mavh);
+    EXPECT_EQ(LinearUtils::FreeSegments(mavh1, _mem_pbase), segs);
 }
 
 TEST_F(LinearTest, remove_used_segment) {
     constexpr uint64_t NUM_USED_SEGMENTS = 10;
     constexpr uint64_t IDX_REMOVE = 6;
     const MavhT mavh0(_linear_mavh);
-    // change mavh to simulate allocations
-    _linear_mavh = _linear_set_mavh(mavh0.MemSz(), mavh0.MavSz(), 5, NUM_USED_SEGMENTS);
-    // fill free segment headers with random bytes
-    auto pmav_f = _mem_pbase + mavh0.MemSz();
-    auto pmav_u = pmav_f + mavh0.MavSz();
-    std::generate(pmav_f, pmav_f + mavh0.MavSz(), []() { return Utils::RandomValue<uint8_t>(); });
-    BufferT expected_mav;
-    std::copy_n(pmav_f, mavh0.MavSz(), std::back_inserter(expected_mav));
-    const auto begin = expected_mav.end() - NUM_USED_SEGMENTS * 8;
-    const auto end = expected_mav.end() - IDX_REMOVE * 8 - 8;
-    const auto end_d = end + 8;
-    std::copy_backward(begin, end, end_d);
+    VecSegsT segs;
+    for (uint64_t i = 0; i < NUM_USED_SEGMENTS; ++i) {
+        segs.emplace_back(i * 64, 32);
+    }
+    const auto mavh = LinearUtils::PrepareUsedSegments(mavh0, _mem_pbase, segs);
+    segs.erase(segs.begin() + IDX_REMOVE);
+
+    const MavhT expected_mavh(mavh0.MemSz(), mavh0.MavSz(), 0, NUM_USED_SEGMENTS - 1);
+    auto pmsh = _linear_used_msh_at(mavh.ToMavh(), _mem_pbase, IDX_REMOVE);
+    const MavhT mavh1(_linear_remove_used_msh(mavh.ToMavh(), _mem_pbase, pmsh));
+    EXPECT_EQ(mavh1, expected_mavh);
+    EXPECT_EQ(LinearUtils::UsedSegments(mavh1, _mem_pbase), segs);
+}
 
-    const MavhT expected_mavh(mavh0.MemSz(), mavh0.MavSz(), 5, NUM_USED_SEGMENTS - 1);
-    auto pmsh = reinterpret_cast<uint64_t*>(pmav_u - IDX_REMOVE * 8);
-    EXPECT_EQ(MavhT(_linear_remove_used_msh(_linear_mavh, _mem_pbase, pmsh)), expected_mavh);
+TEST_F(LinearTest, insert_and_remove_segments_across_pages) {
+    const MavhT mavh0(_linear_mavh);
+    auto mavh = LinearUtils::PrepareSegments(mavh0, _mem_pbase, {}, {}).ToMavh();
+    VecSegsT free_segs, used_segs;
+    std::vector<uint64_t> offsets;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        offsets.push_back(i * 32);
+    }
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937(Utils::RandomValue<uint32_t>()));
+
+    // MSHs spread over many pages and make MAV grow
+    for (const auto offset : offsets) {
+        mavh = _linear_expand_mav_if_necessary(mavh, _mem_pbase);
+        ASSERT_NE(mavh, 0);
+        const MshT msh(offset, 16);
+        mavh = _linear_put_free_msh(mavh, _mem_pbase, msh.ToMsh());
+        mavh = _linear_insert_used_msh(mavh, _mem_pbase, MshT(offset + 16, 8).ToMsh());
+        free_segs.insert(
+              std::lower_bound(free_segs.begin(), free_segs.end(), msh, OrderByOffset), msh);
+        const MshT msh_u(offset + 16, 8);
+        used_segs.insert(
+              std::lower_bound(used_segs.begin(), used_segs.end(), msh_u, OrderByOffset), msh_u);
+    }
+    EXPECT_GT(MavhT(mavh).MavSz(), mavh0.MavSz());
+    EXPECT_EQ(LinearUtils::FreeSegments(MavhT(mavh), _mem_pbase), free_segs);
+    EXPECT_EQ(LinearUtils::UsedSegments(MavhT(mavh), _mem_pbase), used_segs);
+
+    // pages are emptied and merged
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937(Utils::RandomValue<uint32_t>()));
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        const auto offset = offsets[i];
+        auto pmsh = _linear_find_free_msh_by_offset(mavh, _mem_pbase, offset);
+        ASSERT_NE(pmsh, nullptr);
+        mavh = _linear_remove_free_msh(mavh, _mem_pbase, pmsh);
+        pmsh = _linear_find_used_msh(mavh, _mem_pbase, _mem_pbase + offset + 16);
+        ASSERT_NE(pmsh, nullptr);
+        mavh = _linear_remove_used_msh(mavh, _mem_pbase, pmsh);
+        const MshT msh(offset, 16);
+        free_segs.erase(std::lower_bound(free_segs.begin(), free_segs.end(), msh, OrderByOffset));
+        const MshT msh_u(offset + 16, 8);
+        used_segs.erase(
+              std::lower_bound(used_segs.begin(), used_segs.end(), msh_u, OrderByOffset));
+        if (i % 100 == 0) {
+            EXPECT_EQ(LinearUtils::FreeSegments(MavhT(mavh), _mem_pbase), free_segs);
+            EXPECT_EQ(LinearUtils::UsedSegments(MavhT(mavh), _mem_pbase), used_segs);
+        }
+    }
+    EXPECT_EQ(MavhT(mavh).NumFree(), 0);
+    EXPECT_EQ(MavhT(mavh).NumUsed(), 0);
+}
 
-    for (size_t i = 0; i < expected_mav.size(); ++i) {
-        EXPECT_EQ(expected_mav[i], pmav_f[i]) << "for " << i;
+TEST_F(LinearTest, insert_and_remove_segments_across_levels_of_nodes) {
+    const MavhT mavh0(_linear_mavh);
+    auto mavh = LinearUtils::PrepareSegments(mavh0, _mem_pbase, {}, {}).ToMavh();
+    VecSegsT segs;
+
+    // MSHs inserted at the start of the region: the first page splits again and again and so do
+    // the nodes above it
+    for (uint64_t i = 6000; i > 0; --i) {
+        mavh = _linear_expand_mav_if_necessary(mavh, _mem_pbase);
+        ASSERT_NE(mavh, 0);
+        segs.emplace(segs.begin(), (i - 1) * 32, 16);
+        mavh = _linear_put_free_msh(mavh, _mem_pbase, segs.front().ToMsh());
+        ASSERT_NE(mavh, 0);
+    }
+    EXPECT_EQ(MavhT(mavh).NumFree(), segs.size());
+    EXPECT_EQ(LinearUtils::FreeSegments(MavhT(mavh), _mem_pbase), segs);
+
+    // pages and nodes get sparse and merge until the region has no pages
+    std::vector<uint64_t> offsets;
+    for (const auto& seg : segs) {
+        offsets.push_back(seg.Offset());
     }
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937(Utils::RandomValue<uint32_t>()));
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        const auto pmsh = _linear_find_free_msh_by_offset(mavh, _mem_pbase, offsets[i]);
+        ASSERT_NE(pmsh, nullptr);
+        mavh = _linear_remove_free_msh(mavh, _mem_pbase, pmsh);
+        const MshT msh(offsets[i], 16);
+        segs.erase(std::lower_bound(segs.begin(), segs.end(), msh, OrderByOffset));
+        if (i % 500 == 0) {
+            EXPECT_EQ(MavhT(mavh).NumFree(), segs.size());
+            EXPECT_EQ(LinearUtils::FreeSegments(MavhT(mavh), _mem_pbase), segs);
+        }
+    }
+    EXPECT_EQ(MavhT(mavh).NumFree(), 0);
+    EXPECT_EQ(_linear_free_msh_at(mavh, _mem_pbase, 0), nullptr);
+
+    // all the pages are empty again: MAV goes back to its first size
+    mavh = _linear_shrink_mav(mavh, _mem_pbase);
+    EXPECT_EQ(MavhT(mavh).MavSz(), mavh0.MavSz());
+    mavh = _linear_put_free_msh(mavh, _mem_pbase, MshT(64, 16).ToMsh());
+    EXPECT_EQ(LinearUtils::FreeSegments(MavhT(mavh), _mem_pbase), VecSegsT{ MshT(64, 16) });
 }
 
 TEST_F(LinearTest, expand_mav_if_necessary) {
@@ -1018,55 +1573,1260 @@ TEST_F(LinearTest, expand_mav_if_necessary) {
     EXPECT_EQ(_linear_expand_mav_if_necessary(_linear_mavh, _mem_pbase), _linear_mavh);
     EXPECT_EQ(mavh0, MavhT(_linear_mavh));
 
-    // Manipulate mavh to almost full
-    uint8_t* pmav_f = _mem_pbase + mavh0.MemSz();
-    uint8_t* pmav_u = pmav_f + mavh0.MavSz();
+    // fill MAV until it has too few empty pages for a new MSH
+    const auto free_segs = LinearUtils::FreeSegments(mavh0, _mem_pbase);
+    auto mavh = _linear_mavh;
+    VecSegsT used_segs;
+    uint64_t offset = 8;
+    while (_linear_expand_mav_if_necessary(mavh, _mem_pbase) == mavh) {
+        used_segs.emplace_back(offset, 8);
+        mavh = _linear_insert_used_msh(mavh, _mem_pbase, used_segs.back().ToMsh());
+        offset += 16;
+    }
+    const auto expanded =
+          MavhT(mavh0.MemSz(), mavh0.MavSz() * 2, mavh0.NumFree(), used_segs.size());
+    mavh = _linear_expand_mav_if_necessary(mavh, _mem_pbase);
+    EXPECT_EQ(MavhT(mavh), expanded);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
 
-    auto manipulated = _linear_set_mavh(mavh0.MemSz(), mavh0.MavSz(), 256, 255);
-    EXPECT_EQ(_linear_expand_mav_if_necessary(manipulated, _mem_pbase), manipulated);
-    EXPECT_EQ(mavh0, MavhT(_linear_mavh));
+    // MSHs are kept and the new pages are used
+    EXPECT_EQ(LinearUtils::UsedSegments(MavhT(mavh), _mem_pbase), used_segs);
+    for (size_t i = 0; i < 256; ++i) {
+        used_segs.emplace_back(offset, 8);
+        mavh = _linear_insert_used_msh(mavh, _mem_pbase, used_segs.back().ToMsh());
+        offset += 16;
+    }
+    EXPECT_EQ(_linear_expand_mav_if_necessary(mavh, _mem_pbase), mavh);
+    EXPECT_EQ(LinearUtils::UsedSegments(MavhT(mavh), _mem_pbase), used_segs);
+    EXPECT_EQ(LinearUtils::FreeSegments(MavhT(mavh), _mem_pbase), free_segs);
+}
 
-    constexpr uint64_t num_mavu_bytes = 256 * 8;
-    auto begin_mavu = pmav_u - num_mavu_bytes;
-    auto begin_new_mavu = pmav_u + mavh0.MavSz() - num_mavu_bytes;
+TEST_F(LinearTest, shrink_mav) {
+    const MavhT mavh0(_linear_mavh);
+    // It won't shrink the smallest MAV
+    EXPECT_EQ(_linear_shrink_mav(_linear_mavh, _mem_pbase), _linear_mavh);
+
+    // MSHs in random order spread over the pages of a MAV 8 times bigger
+    const auto free_segs = LinearUtils::FreeSegments(mavh0, _mem_pbase);
+    std::vector<uint64_t> offsets;
+    for (uint64_t i = 0; i < 1500; ++i) {
+        offsets.push_back(8 + i * 16);
+    }
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937(Utils::RandomValue<uint32_t>()));
+    auto mavh = _linear_mavh;
+    for (const auto offset : offsets) {
+        mavh = _linear_expand_mav_if_necessary(mavh, _mem_pbase);
+        ASSERT_NE(mavh, 0);
+        mavh = _linear_insert_used_msh(mavh, _mem_pbase, MshT(offset, 8).ToMsh());
+    }
+    ASSERT_EQ(MavhT(mavh).MavSz(), 8 * mavh0.MavSz());
+    // MAV full enough is not halved
+    EXPECT_EQ(_linear_shrink_mav(mavh, _mem_pbase), mavh);
+
+    // the MSHs left take a few pages: MAV is halved while they take at most half of its pages
+    std::shuffle(offsets.begin(), offsets.end(), std::mt19937(Utils::RandomValue<uint32_t>()));
+    VecSegsT used_segs;
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        if (i < 100) {
+            used_segs.emplace_back(offsets[i], 8);
+            continue;
+        }
+        const auto pmsh = _linear_find_used_msh(mavh, _mem_pbase, _mem_pbase + offsets[i]);
+        ASSERT_NE(pmsh, nullptr);
+        mavh = _linear_remove_used_msh(mavh, _mem_pbase, pmsh);
+    }
+    std::sort(used_segs.begin(), used_segs.end(), OrderByOffset);
+    mavh = _linear_shrink_mav(mavh, _mem_pbase);
+    EXPECT_LT(MavhT(mavh).MavSz(), 8 * mavh0.MavSz());
+    EXPECT_EQ(MavhT(mavh).NumUsed(), used_segs.size());
+    EXPECT_EQ(LinearUtils::UsedSegments(MavhT(mavh), _mem_pbase), used_segs);
+    EXPECT_EQ(LinearUtils::FreeSegments(MavhT(mavh), _mem_pbase), free_segs);
+
+    // the smaller MAV takes new MSHs and grows again
+    for (uint64_t i = 0; i < 1000; ++i) {
+        mavh = _linear_expand_mav_if_necessary(mavh, _mem_pbase);
+        ASSERT_NE(mavh, 0);
+        used_segs.emplace_back(0x10'0000 + i * 16, 8);
+        mavh = _linear_insert_used_msh(mavh, _mem_pbase, used_segs.back().ToMsh());
+    }
+    EXPECT_EQ(LinearUtils::UsedSegments(MavhT(mavh), _mem_pbase), used_segs);
+    EXPECT_EQ(LinearUtils::FreeSegments(MavhT(mavh), _mem_pbase), free_segs);
+}
 
-    // fill used segment headers with random bytes
-    std::generate_n(begin_mavu, num_mavu_bytes, []() { return Utils::RandomValue<uint8_t>(); });
-    // Manipulate mavh to full
-    manipulated = _linear_set_mavh(mavh0.MemSz(), mavh0.MavSz(), 256, 256);
-    auto expanded = _linear_set_mavh(mavh0.MemSz(), mavh0.MavSz() * 2, 256, 256);
-    EXPECT_EQ(_linear_expand_mav_if_necessary(manipulated, _mem_pbase), expanded);
-    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+TEST_F(LinearTest, lower_bound_free_segment_manual_buffer) {
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x1000;
+    uint8_t buffer[mem_sz + mav_sz];
 
-    EXPECT_EQ(memcmp(begin_mavu, begin_new_mavu, num_mavu_bytes), 0);
+    VecSegsT segs = {
+        MshT(0, 64),
+        MshT(512, 16),
+        MshT(1024, 32),
+        MshT(1064, 64),
+    };
+    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
+    for (uint64_t offset = 0; offset < 1600; offset += 8) {
+        SCOPED_TRACE("offset = " + std::to_string(offset));
+        const auto expected =
+              std::lower_bound(segs.begin(), segs.end(), MshT(offset, 0), OrderByOffset);
+        EXPECT_EQ(
+              _linear_lower_bound_free_msh(mavh.ToMavh(), buffer, offset),
+              _linear_free_msh_at(mavh.ToMavh(), buffer, expected - segs.begin()));
+    }
+    const auto empty = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, {});
+    EXPECT_EQ(_linear_lower_bound_free_msh(empty.ToMavh(), buffer, 512), nullptr);
+}
+
+TEST_F(LinearTest, lower_bound_used_segment_manual_buffer) {
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x1000;
+    uint8_t buffer[mem_sz + mav_sz];
+
+    VecSegsT segs = {
+        MshT(512, 16),
+        MshT(1024, 32),
+        MshT(1064, 64),
+        MshT(2048, 512),
+        MshT(4096, 8),
+    };
+    const auto mavh = LinearUtils::PrepareUsedSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
+    for (uint64_t offset = 0; offset < 4200; offset += 8) {
+        SCOPED_TRACE("offset = " + std::to_string(offset));
+        const auto expected =
+              std::lower_bound(segs.begin(), segs.end(), MshT(offset, 0), OrderByOffset);
+        EXPECT_EQ(
+              _linear_lower_bound_used_msh(mavh.ToMavh(), buffer, offset),
+              _linear_used_msh_at(mavh.ToMavh(), buffer, expected - segs.begin()));
+    }
+    const auto empty = LinearUtils::PrepareUsedSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, {});
+    EXPECT_EQ(_linear_lower_bound_used_msh(empty.ToMavh(), buffer, 512), nullptr);
+}
+
+TEST_F(LinearTest, find_free_segment_by_offset_manual_buffer) {
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x1000;
+    uint8_t buffer[mem_sz + mav_sz];
+
+    VecSegsT segs;
+    for (uint64_t i = 0; i < 100; ++i) {
+        segs.emplace_back(i * 64, 32);
+    }
+    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
+    for (uint64_t offset = 0; offset < 100 * 64; offset += 8) {
+        SCOPED_TRACE("offset = " + std::to_string(offset));
+        const auto expected = (offset % 64 == 0)
+                                    ? _linear_free_msh_at(mavh.ToMavh(), buffer, offset / 64)
+                                    : nullptr;
+        EXPECT_EQ(_linear_find_free_msh_by_offset(mavh.ToMavh(), buffer, offset), expected);
+    }
+}
+
+TEST_F(LinearTest, size_class) {
+    EXPECT_EQ(_linear_size_class(8), 3);
+    EXPECT_EQ(_linear_size_class(16), 4);
+    EXPECT_EQ(_linear_size_class(24), 4);
+    EXPECT_EQ(_linear_size_class(120), 6);
+    EXPECT_EQ(_linear_size_class(128), 7);
+    for (uint64_t k = 3; k < 63; ++k) {
+        const uint64_t size = uint64_t(1) << k;
+        EXPECT_EQ(_linear_size_class(size), k);
+        EXPECT_EQ(_linear_size_class(size + 8), k);
+        EXPECT_EQ(_linear_size_class(2 * size - 8), k);
+    }
+}
+
+TEST_F(LinearTest, bins_build_manual_buffer) {
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x1000;
+    uint8_t buffer[mem_sz + mav_sz];
+    uint64_t bins[LINEAR_BINS];
+
+    const VecSegsT segs = {
+        MshT(0, 16),
+        MshT(32, 32),
+        MshT(128, 64),
+        MshT(256, 48),
+        MshT(1024, 512),
+    };
+    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
+    _linear_bins_build(bins, mavh.ToMavh(), buffer);
+    EXPECT_EQ(bins[0], mavh.ToMavh());
+    EXPECT_EQ(bins[1], (1u << 4) | (1u << 5) | (1u << 6) | (1u << 9));
+    LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
+    // blocks of the same class are linked in address order
+    EXPECT_EQ(bins[2 + 5], 32 / 8);
+    EXPECT_EQ(LinearUtils::BinsNode(buffer, 32 / 8) >> 32, 256 / 8);
+
+    // rebuilt only if the MAVH is different
+    bins[1] = 0;
+    _linear_bins_sync(bins, mavh.ToMavh(), buffer);
+    EXPECT_EQ(bins[1], 0);
+    bins[0] = 0;
+    _linear_bins_sync(bins, mavh.ToMavh(), buffer);
+    EXPECT_EQ(bins[0], mavh.ToMavh());
+    LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
+}
+
+TEST_F(LinearTest, bins_insert_and_remove_manual_buffer) {
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x1000;
+    uint8_t buffer[mem_sz + mav_sz];
+    uint64_t bins[LINEAR_BINS];
+    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, {});
+    _linear_bins_build(bins, mavh.ToMavh(), buffer); // no free segments: all classes empty
+    EXPECT_EQ(bins[1], 0);
+
+    VecSegsT segs = {
+        MshT(0, 16),
+        MshT(64, 24),
+        MshT(128, 8),
+        MshT(256, 512),
+        MshT(2048, 16),
+    };
+    for (const auto& seg : segs) {
+        _linear_bins_insert(bins, buffer, seg.ToMsh());
+    }
+    LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
+    _linear_bins_insert(bins, buffer, MshT(4096, 0).ToMsh()); // empty blocks are ignored
+    LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
+
+    while (not segs.empty()) {
+        const auto idx = Utils::RandomValue<size_t>(0, segs.size() - 1);
+        _linear_bins_remove(bins, buffer, segs[idx].ToMsh());
+        segs.erase(segs.begin() + idx);
+        LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
+    }
+    EXPECT_EQ(bins[1], 0);
+}
+
+TEST_F(LinearTest, bins_find_free_segment_manual_buffer) {
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x1000;
+    uint8_t buffer[mem_sz + mav_sz];
+    uint64_t bins[LINEAR_BINS];
+    const VecSegsT segs = {
+        MshT(0, 16),
+        MshT(128, 32),
+        MshT(256, 64),
+        MshT(1024, 512),
+    };
+    auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
+    _linear_bins_build(bins, mavh.ToMavh(), buffer);
+
+    // sizes ascending: same result as first fit
+    for (uint64_t sz = 8; sz <= 512; sz += 8) {
+        SCOPED_TRACE("size = " + std::to_string(sz));
+        EXPECT_EQ(
+              _linear_bins_find_free_msh(bins, mavh.ToMavh(), buffer, sz),
+              _linear_find_free_msh(mavh.ToMavh(), buffer, sz));
+    }
+    EXPECT_EQ(_linear_bins_find_free_msh(bins, mavh.ToMavh(), buffer, 520), nullptr);
+
+    // only the class below the requested size has blocks that fit
+    const VecSegsT segs_below = {
+        MshT(0, 16),
+        MshT(64, 40),
+        MshT(128, 48),
+    };
+    mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs_below);
+    _linear_bins_build(bins, mavh.ToMavh(), buffer);
+    EXPECT_EQ(
+          _linear_bins_find_free_msh(bins, mavh.ToMavh(), buffer, 40),
+          _linear_free_msh_at(mavh.ToMavh(), buffer, 1));
+    EXPECT_EQ(
+          _linear_bins_find_free_msh(bins, mavh.ToMavh(), buffer, 48),
+          _linear_free_msh_at(mavh.ToMavh(), buffer, 2));
+    EXPECT_EQ(_linear_bins_find_free_msh(bins, mavh.ToMavh(), buffer, 56), nullptr);
+}
+
+TEST_F(LinearTest, bins_find_best_segment_manual_buffer) {
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x1000;
+    uint8_t buffer[mem_sz + mav_sz];
+    uint64_t bins[LINEAR_BINS];
+    const VecSegsT segs = {
+        MshT(0, 48),
+        MshT(128, 40),
+        MshT(256, 64),
+        MshT(1024, 512),
+    };
+    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
+    _linear_bins_build(bins, mavh.ToMavh(), buffer);
+
+    const std::vector<std::pair<uint64_t, uint64_t>> expected = {
+        { 8, 1 }, { 32, 1 }, { 40, 1 }, { 48, 0 }, { 56, 2 }, { 64, 2 }, { 72, 3 }, { 512, 3 },
+    };
+    for (const auto& [sz, idx] : expected) {
+        SCOPED_TRACE("size = " + std::to_string(sz));
+        EXPECT_EQ(
+              _linear_bins_find_best_msh(bins, mavh.ToMavh(), buffer, sz),
+              _linear_free_msh_at(mavh.ToMavh(), buffer, idx));
+    }
+    EXPECT_EQ(_linear_bins_find_best_msh(bins, mavh.ToMavh(), buffer, 520), nullptr);
+}
+
+TEST_F(LinearTest, find_free_segment_next_fit_manual_buffer) {
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x1000;
+    constexpr uint64_t ROVER = 133;
+    uint8_t buffer[mem_sz + mav_sz];
+    uint64_t bins[LINEAR_BINS];
+    const VecSegsT segs = {
+        MshT(0, 16),
+        MshT(128, 32),
+        MshT(256, 64),
+        MshT(1024, 24),
+    };
+    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
+    const auto next_fit = [&](uint64_t sz) {
+        return _linear_find_free_msh_next_fit(bins, mavh.ToMavh(), buffer, sz);
+    };
+    const auto at = [&](uint64_t idx) {
+        return _linear_free_msh_at(mavh.ToMavh(), buffer, idx);
+    };
+
+    // the search starts at the block of the previous one
+    bins[ROVER] = 0;
+    EXPECT_EQ(next_fit(16), at(0));
+    EXPECT_EQ(bins[ROVER], 0);
+    EXPECT_EQ(next_fit(32), at(1));
+    EXPECT_EQ(bins[ROVER], 128);
+    EXPECT_EQ(next_fit(16), at(1));
+    bins[ROVER] = 300;
+    EXPECT_EQ(next_fit(16), at(3));
+    EXPECT_EQ(bins[ROVER], 1024);
+
+    // it wraps around at the end of memory
+    EXPECT_EQ(next_fit(48), at(2));
+    EXPECT_EQ(bins[ROVER], 256);
+    bins[ROVER] = 2048;
+    EXPECT_EQ(next_fit(8), at(0));
+    bins[ROVER] = 128;
+    EXPECT_EQ(next_fit(72), nullptr);
+    EXPECT_EQ(bins[ROVER], 128);
+}
+
+TEST_F(LinearTest, bins_insert_free_segment_manual_buffer) {
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x1000;
+    uint8_t buffer[mem_sz + mav_sz];
+    uint64_t bins[LINEAR_BINS];
+    VecSegsT segs = {
+        MshT(0, 16),
+        MshT(32, 32),
+        MshT(128, 64),
+        MshT(1024, 512),
+    };
+    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
+    _linear_bins_build(bins, mavh.ToMavh(), buffer);
+
+    // joins behind and ahead
+    auto mavh1 =
+          MavhT(_linear_bins_insert_free_msh(bins, mavh.ToMavh(), buffer, MshT(16, 16).ToMsh()));
+    segs = { MshT(0, 64), MshT(128, 64), MshT(1024, 512) };
+    EXPECT_EQ(mavh1.NumFree(), segs.size());
+    LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
+
+    // joins behind only
+    mavh1 = MavhT(
+          _linear_bins_insert_free_msh(bins, mavh1.ToMavh(), buffer, MshT(64, 32).ToMsh()));
+    segs = { MshT(0, 96), MshT(128, 64), MshT(1024, 512) };
+    EXPECT_EQ(mavh1.NumFree(), segs.size());
+    LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
+
+    // joins ahead only
+    mavh1 = MavhT(
+          _linear_bins_insert_free_msh(bins, mavh1.ToMavh(), buffer, MshT(768, 256).ToMsh()));
+    segs = { MshT(0, 96), MshT(128, 64), MshT(768, 768) };
+    EXPECT_EQ(mavh1.NumFree(), segs.size());
+    LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
+
+    // does not join
+    mavh1 = MavhT(
+          _linear_bins_insert_free_msh(bins, mavh1.ToMavh(), buffer, MshT(256, 8).ToMsh()));
+    segs = { MshT(0, 96), MshT(128, 64), MshT(256, 8), MshT(768, 768) };
+    EXPECT_EQ(mavh1.NumFree(), segs.size());
+    LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
+    EXPECT_EQ(LinearUtils::FreeSegments(mavh1, buffer), segs);
+}
+
+TEST_F(LinearTest, bins_insert_free_segment_mav_full) {
+    constexpr uint64_t mem_sz = 0x8'0000;
+    constexpr uint64_t mav_sz = 0x1000;
+    uint8_t buffer[mem_sz + mav_sz];
+    uint64_t bins[LINEAR_BINS];
+    // the 7 pages of MAV are taken: a node over 6 pages of MSHs, 5 of 31 MSHs and a last one of 62
+    constexpr uint64_t num_segs = 5 * 31 + 62;
+    VecSegsT segs;
+    for (uint64_t i = 0; i < num_segs; ++i) {
+        segs.emplace_back(i * 64, 32);
+    }
+    const auto mavh = LinearUtils::PrepareFreeSegments(MavhT(mem_sz, mav_sz, 0, 0), buffer, segs);
+    ASSERT_EQ(mavh.NumFree(), num_segs);
+    _linear_bins_build(bins, mavh.ToMavh(), buffer);
+
+    // a block that does not join needs a page: it fails and the bins still match MAV
+    uint64_t bins0[LINEAR_BINS];
+    std::copy_n(bins, LINEAR_BINS, bins0);
+    const auto msh = MshT(num_segs * 64 + 128, 8).ToMsh();
+    EXPECT_EQ(_linear_bins_insert_free_msh(bins, mavh.ToMavh(), buffer, msh), 0);
+    EXPECT_TRUE(std::equal(bins, bins + LINEAR_BINS, bins0));
+    LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
+
+    // blocks that join need no page
+    auto mavh1 =
+          MavhT(_linear_bins_insert_free_msh(bins, mavh.ToMavh(), buffer, MshT(32, 8).ToMsh()));
+    mavh1 = MavhT(
+          _linear_bins_insert_free_msh(bins, mavh1.ToMavh(), buffer, MshT(40, 24).ToMsh()));
+    segs.erase(segs.begin(), segs.begin() + 2);
+    segs.insert(segs.begin(), MshT(0, 96));
+    EXPECT_EQ(LinearUtils::FreeSegments(mavh1, buffer), segs);
+    LinearUtils::CheckBins(__LINE__, bins, buffer, segs);
 }
 
 TEST_F(LinearTest, block_offset) {
-    EXPECT_EQ(_linear_block_offset(0x0000'0000'0000'0000), 0);
-    EXPECT_EQ(_linear_block_offset(0x0000'0001'0000'0000), 8);
-    EXPECT_EQ(_linear_block_offset(0x0000'0002'0000'0000), 16);
-    EXPECT_EQ(_linear_block_offset(0x0000'0020'0000'0000), 256);
+    const auto mavh = _linear_set_mavh(0x1000'0000, 0x1000, 0, 0);
+    EXPECT_EQ(_linear_block_offset(0x0000'0000'0000'0000, mavh), 0);
+    EXPECT_EQ(_linear_block_offset(0x0000'0001'0000'0000, mavh), 8);
+    EXPECT_EQ(_linear_block_offset(0x0000'0002'0000'0000, mavh), 16);
+    EXPECT_EQ(_linear_block_offset(0x0000'0020'0000'0000, mavh), 256);
+    const auto wide = _linear_set_mavh(uint64_t(1) << 36, 0x1000, 0, 0);
+    EXPECT_EQ(_linear_block_offset(0x0000'0020'0000'0000, wide), 1024);
     for (uint64_t bits = 1; bits <= 32; ++bits) {
         uint64_t msh = Utils::RandomValue<uint64_t>();
         msh &= 0x0000'0000'ffff'ffff;
         const uint64_t size = (uint64_t(1) << bits) - 1;
         msh |= size << 32;
-        EXPECT_EQ(_linear_block_offset(msh), size * 8) << LinearUtils::MshToString(msh);
+        EXPECT_EQ(_linear_block_offset(msh, mavh), size * 8) << LinearUtils::MshToString(msh);
     }
 }
 
 TEST_F(LinearTest, block_size) {
-    EXPECT_EQ(_linear_block_size(0x0000'0000'0000'0000), 0);
-    EXPECT_EQ(_linear_block_size(0x0000'0000'0000'0001), 8);
-    EXPECT_EQ(_linear_block_size(0x0000'0000'0000'0002), 16);
-    EXPECT_EQ(_linear_block_size(0x0000'0000'0000'0020), 256);
+    const auto mavh = _linear_set_mavh(0x1000'0000, 0x1000, 0, 0);
+    EXPECT_EQ(_linear_block_size(0x0000'0000'0000'0000, mavh), 0);
+    EXPECT_EQ(_linear_block_size(0x0000'0000'0000'0001, mavh), 8);
+    EXPECT_EQ(_linear_block_size(0x0000'0000'0000'0002, mavh), 16);
+    EXPECT_EQ(_linear_block_size(0x0000'0000'0000'0020, mavh), 256);
+    const auto wide = _linear_set_mavh(uint64_t(1) << 36, 0x1000, 0, 0);
+    EXPECT_EQ(_linear_block_size(0x0000'0000'0000'0020, wide), 1024);
     for (uint64_t bits = 1; bits <= 32; ++bits) {
         uint64_t msh = Utils::RandomValue<uint64_t>();
         msh &= 0xffff'ffff'0000'0000;
         const uint64_t size = (uint64_t(1) << bits) - 1;
         msh |= size;
-        EXPECT_EQ(_linear_block_size(msh), size * 8) << LinearUtils::MshToString(msh);
+        EXPECT_EQ(_linear_block_size(msh, mavh), size * 8) << LinearUtils::MshToString(msh);
+    }
+}
+
+class LinearConcurrentTest : public MemoryTestBase {
+public:
+    void SetUp() override {
+        MemoryTestBase::SetUp();
+        EXPECT_EQ(linear_init_with_options(2'000'000, LINEAR_CONCURRENT), 0);
+    }
+    void TearDown() override {
+        linear_deinit();
+        MemoryTestBase::TearDown();
+    }
+};
+
+TEST_F(LinearConcurrentTest, inited) {
+    EXPECT_EQ(_linear_options, LINEAR_CONCURRENT);
+    EXPECT_EQ(MavhT(_linear_mavh).NumFree(), 1);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 0);
+    linear_deinit();
+    EXPECT_EQ(_linear_options, 0);
+    EXPECT_EQ(linear_init(2'000'000), 0);
+    EXPECT_EQ(_linear_options, 0);
+}
+
+TEST_F(LinearConcurrentTest, allocate_from_magazine) {
+    const MavhT mavh0(_linear_mavh);
+    // the size of the block is kept before it
+    auto ptr = static_cast<uint8_t*>(linear_allocate(24));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(ptr, pool_ + mavh0.MemSz() - 24);
+    EXPECT_EQ(*reinterpret_cast<uint64_t*>(ptr - 8), 24);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1);
+
+    // small blocks stay in the magazine of the thread (used in MAV) and are allocated again
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1);
+    EXPECT_EQ(linear_allocate(20), ptr);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+
+    // big blocks go straight back to the pool
+    auto big = linear_allocate(4096);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1); // the lower 26 bits of 2^26 + 1
+    EXPECT_EQ(linear_deallocate(big), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1);
+
+    EXPECT_EQ(linear_thread_flush(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+}
+
+TEST_F(LinearConcurrentTest, invalid_pointer) {
+    const MavhT mavh0(_linear_mavh);
+    auto ptr = static_cast<uint8_t*>(linear_allocate(24));
+    ASSERT_NE(ptr, nullptr);
+    auto size = reinterpret_cast<uint64_t*>(ptr - 8);
+
+    // pointers that are not aligned or out of the pool
+    EXPECT_EQ(linear_deallocate(nullptr), -1);
+    EXPECT_EQ(linear_deallocate(ptr + 4), -1);
+    EXPECT_EQ(linear_deallocate(pool_), -1);
+    EXPECT_EQ(linear_deallocate(pool_ + mavh0.MemSz()), -1);
+    uint64_t local[2] = { 24, 0 };
+    EXPECT_EQ(linear_deallocate(&local[1]), -1);
+
+    // sizes that no block has
+    *size = 0;
+    EXPECT_EQ(linear_deallocate(ptr), -1);
+    *size = 20;
+    EXPECT_EQ(linear_deallocate(ptr), -1);
+    *size = 24;
+
+    // a block in the magazine is not deallocated twice
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+    EXPECT_EQ(linear_deallocate(ptr), -1);
+    EXPECT_EQ(linear_allocate(24), ptr);
+    EXPECT_NE(linear_allocate(24), ptr);
+
+    // the size must match the block in MAV
+    *size = 16;
+    EXPECT_EQ(linear_deallocate(ptr), -1);
+    *size = 32;
+    EXPECT_EQ(linear_deallocate(ptr), -1);
+    *size = 24;
+
+    // a pointer in the middle of a block is not a block
+    auto big = static_cast<uint8_t*>(linear_allocate(64));
+    ASSERT_NE(big, nullptr);
+    *reinterpret_cast<uint64_t*>(big + 24) = 16;
+    EXPECT_EQ(linear_deallocate(big + 32), -1);
+    EXPECT_EQ(linear_reallocate(big + 32, 100), nullptr);
+
+    // a block in the magazine is not reallocated
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+    EXPECT_EQ(linear_reallocate(ptr, 100), nullptr);
+    EXPECT_EQ(linear_deallocate(big), 0);
+    EXPECT_EQ(linear_thread_flush(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+}
+
+TEST_F(LinearConcurrentTest, reallocate) {
+    const MavhT mavh0(_linear_mavh);
+    auto top = linear_allocate(300);
+    auto ptr = static_cast<uint8_t*>(linear_allocate(300));
+    ASSERT_NE(top, nullptr);
+    ASSERT_NE(ptr, nullptr);
+    std::fill_n(ptr, 300, 'r');
+
+    // it grows in place into the free block after it
+    EXPECT_EQ(linear_deallocate(top), 0);
+    EXPECT_EQ(linear_reallocate(ptr, 600), ptr);
+    EXPECT_EQ(*reinterpret_cast<uint64_t*>(ptr - 8), 600);
+
+    // it moves when there is no room after it and shrinking keeps the block
+    auto moved = static_cast<uint8_t*>(linear_reallocate(ptr, 5000));
+    ASSERT_NE(moved, nullptr);
+    EXPECT_NE(moved, ptr);
+    EXPECT_EQ(*reinterpret_cast<uint64_t*>(moved - 8), 5000);
+    EXPECT_EQ(std::count(moved, moved + 300, 'r'), 300);
+    EXPECT_EQ(linear_reallocate(moved, 100), moved);
+
+    EXPECT_EQ(linear_deallocate(moved), 0);
+    EXPECT_EQ(linear_thread_flush(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+}
+
+TEST_F(LinearConcurrentTest, magazines_of_ended_threads) {
+    const MavhT mavh0(_linear_mavh);
+    const auto orphan = [](uint64_t size, int count) {
+        std::thread thread([size, count]() {
+            std::vector<void*> ptrs;
+            for (int i = 0; i < count; ++i) {
+                ptrs.push_back(linear_allocate(size));
+            }
+            // the blocks stay in the magazine when the thread ends
+            for (auto ptr : ptrs) {
+                EXPECT_EQ(linear_deallocate(ptr), 0);
+            }
+        });
+        thread.join();
+    };
+
+    // linear_trim gives them back to the pool
+    orphan(24, 10);
+    orphan(64, 10);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 20);
+    EXPECT_EQ(linear_trim(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 0);
+
+    // an allocation that does not fit gives them back too
+    orphan(64, 16);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 16);
+    auto big = linear_allocate(mavh0.MemSz() - 8 * 72);
+    EXPECT_NE(big, nullptr);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1);
+    EXPECT_EQ(linear_deallocate(big), 0);
+
+    // more threads than magazines
+    for (int i = 0; i < 100; ++i) {
+        orphan(32, 2);
+    }
+    EXPECT_EQ(linear_trim(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 0);
+}
+
+TEST_F(LinearConcurrentTest, allocate_aligned) {
+    const MavhT mavh0(_linear_mavh);
+    std::vector<void*> ptrs;
+    for (uint64_t alignment = 16; alignment <= 4096; alignment *= 2) {
+        auto ptr = static_cast<uint8_t*>(linear_allocate_aligned(24, alignment));
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignment, 0);
+        // the size is kept before the aligned block
+        EXPECT_EQ(*reinterpret_cast<uint64_t*>(ptr - 8), 24);
+        ptrs.push_back(ptr);
+    }
+    for (auto ptr : ptrs) {
+        EXPECT_EQ(linear_deallocate(ptr), 0);
+    }
+    EXPECT_EQ(linear_thread_flush(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+}
+
+TEST_F(LinearConcurrentTest, allocate_and_deallocate_batch) {
+    const MavhT mavh0(_linear_mavh);
+    const std::vector<uint64_t> sizes = { 8, 300, 0, 16 };
+    std::vector<void*> ptrs(sizes.size());
+    EXPECT_EQ(linear_allocate_batch(sizes.data(), sizes.size(), ptrs.data()), 0);
+    EXPECT_EQ(ptrs[2], nullptr);
+    // the size is kept before each block
+    EXPECT_EQ(*reinterpret_cast<uint64_t*>(static_cast<uint8_t*>(ptrs[1]) - 8), 304);
+    EXPECT_EQ(linear_deallocate_batch(ptrs.data(), ptrs.size()), 0);
+    EXPECT_EQ(linear_thread_flush(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+}
+
+TEST_F(LinearConcurrentTest, full_magazine_goes_back_to_pool) {
+    const MavhT mavh0(_linear_mavh);
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 40; ++i) {
+        ptrs.push_back(linear_allocate(64));
+        ASSERT_NE(ptrs.back(), nullptr);
+    }
+    for (auto ptr : ptrs) {
+        EXPECT_EQ(linear_deallocate(ptr), 0);
+    }
+    // a magazine holds at most 16 blocks
+    EXPECT_LE(MavhT(_linear_mavh).NumUsed(), 16);
+    EXPECT_GT(MavhT(_linear_mavh).NumUsed(), 0);
+    EXPECT_EQ(linear_thread_flush(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+}
+
+TEST_F(LinearConcurrentTest, reinit_forgets_magazines) {
+    auto ptr = linear_allocate(32);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+    linear_deinit();
+    EXPECT_EQ(linear_init_with_options(2'000'000, LINEAR_CONCURRENT), 0);
+    // the block in the magazine belonged to the previous pool
+    EXPECT_NE(linear_allocate(32), nullptr);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1);
+}
+
+TEST_F(LinearConcurrentTest, lock) {
+    constexpr int NUM_THREADS = 8;
+    constexpr int NUM_INCREMENTS = 100'000;
+    uint64_t lock = 0;
+    uint64_t counter = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < NUM_THREADS; ++i) {
+        threads.emplace_back([&lock, &counter]() {
+            for (int j = 0; j < NUM_INCREMENTS; ++j) {
+                _linear_lock_acquire(&lock);
+                counter = counter + 1;
+                _linear_lock_release(&lock);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(counter, uint64_t(NUM_THREADS) * NUM_INCREMENTS);
+    EXPECT_EQ(lock, 0);
+}
+
+TEST_F(LinearConcurrentTest, stress) {
+    constexpr int NUM_THREADS = 8;
+    constexpr int NUM_OPERATIONS = 20'000;
+    constexpr size_t NUM_SLOTS = 64;
+    const MavhT mavh0(_linear_mavh);
+    std::vector<int64_t> errors(NUM_THREADS, 0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < NUM_THREADS; ++i) {
+        threads.emplace_back([i, &errors]() {
+            const char c = 'A' + i;
+            std::mt19937 gen(i);
+            std::vector<std::pair<uint8_t*, uint64_t>> slots(NUM_SLOTS, { nullptr, 0 });
+            auto release = [c, &errors, i](std::pair<uint8_t*, uint64_t>& slot) {
+                auto [ptr, size] = slot;
+                // no other thread wrote to the block
+                if (std::count(ptr, ptr + size, c) != int64_t(size)) {
+                    ++errors[i];
+                }
+                if (linear_deallocate(ptr) != 0) {
+                    ++errors[i];
+                }
+                slot = { nullptr, 0 };
+            };
+            for (int j = 0; j < NUM_OPERATIONS; ++j) {
+                auto& slot = slots[gen() % NUM_SLOTS];
+                if (slot.first != nullptr) {
+                    release(slot);
+                    continue;
+                }
+                // mostly small blocks (magazines) and some big ones (pool)
+                const uint64_t size = (gen() % 8 == 0) ? 512 + gen() % 4096 : 1 + gen() % 256;
+                auto ptr = static_cast<uint8_t*>(linear_allocate_filled(size, c));
+                if (ptr != nullptr) {
+                    slot = { ptr, size };
+                }
+            }
+            for (auto& slot : slots) {
+                if (slot.first != nullptr) {
+                    release(slot);
+                }
+            }
+            if (linear_thread_flush() != 0) {
+                ++errors[i];
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(errors, std::vector<int64_t>(NUM_THREADS, 0));
+    EXPECT_EQ(_linear_lock, 0);
+    // all blocks went back to the pool
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+}
+
+class LinearDeferredTest : public MemoryTestBase {
+public:
+    void SetUp() override {
+        MemoryTestBase::SetUp();
+        EXPECT_EQ(linear_init_with_options(2'000'000, LINEAR_DEFERRED), 0);
+    }
+    void TearDown() override {
+        linear_deinit();
+        MemoryTestBase::TearDown();
+    }
+};
+
+TEST_F(LinearDeferredTest, allocate_from_quick_list) {
+    const MavhT mavh0(_linear_mavh);
+    auto ptr = static_cast<uint8_t*>(linear_allocate(24));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(ptr, pool_ + mavh0.MemSz() - 24);
+
+    // small blocks are parked (used in MAV) and allocated again
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1);
+    EXPECT_EQ(linear_allocate(20), ptr);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+
+    // big blocks go straight back to the pool
+    auto big = linear_allocate(4096);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1); // the lower 26 bits of 2^26 + 1
+    EXPECT_EQ(linear_deallocate(big), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1);
+
+    // a pointer that was not allocated is not parked
+    EXPECT_NE(linear_deallocate(ptr + 8), 0);
+
+    EXPECT_EQ(linear_thread_flush(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+}
+
+TEST_F(LinearDeferredTest, double_free) {
+    const MavhT mavh0(_linear_mavh);
+    auto ptr = linear_allocate(24);
+    auto other = linear_allocate(24);
+    ASSERT_NE(ptr, nullptr);
+    ASSERT_NE(other, nullptr);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+    EXPECT_EQ(linear_deallocate(other), 0);
+
+    // the blocks are parked (used in MAV), but they are not parked twice
+    EXPECT_EQ(linear_deallocate(ptr), -1);
+    EXPECT_EQ(linear_deallocate(other), -1);
+
+    EXPECT_EQ(linear_thread_flush(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+    EXPECT_EQ(linear_deallocate(ptr), -1);
+}
+
+TEST_F(LinearDeferredTest, full_quick_list_is_coalesced) {
+    const MavhT mavh0(_linear_mavh);
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 40; ++i) {
+        ptrs.push_back(linear_allocate(64));
+        ASSERT_NE(ptrs.back(), nullptr);
+    }
+    for (auto ptr : ptrs) {
+        EXPECT_EQ(linear_deallocate(ptr), 0);
+    }
+    // a quick-list holds at most 32 blocks
+    EXPECT_LE(MavhT(_linear_mavh).NumUsed(), 32);
+    EXPECT_GT(MavhT(_linear_mavh).NumUsed(), 0);
+    EXPECT_EQ(linear_thread_flush(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+}
+
+TEST_F(LinearDeferredTest, allocation_failure_coalesces) {
+    const MavhT mavh0(_linear_mavh);
+    std::vector<uint8_t*> ptrs;
+    for (int i = 0; i < 16; ++i) {
+        ptrs.push_back(static_cast<uint8_t*>(linear_allocate(128)));
+        ASSERT_NE(ptrs.back(), nullptr);
+    }
+    auto big = linear_allocate(mavh0.MemSz() - 16 * 128);
+    ASSERT_NE(big, nullptr);
+    for (auto ptr : ptrs) {
+        EXPECT_EQ(linear_deallocate(ptr), 0);
+    }
+    EXPECT_EQ(MavhT(_linear_mavh).NumFree(), 0);
+
+    // only the parked blocks together have room for it
+    EXPECT_EQ(linear_allocate(16 * 128), ptrs.back());
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1); // the lower 26 bits of 2^26 + 1
+    EXPECT_EQ(MavhT(_linear_mavh).NumFree(), 0);
+}
+
+TEST_F(LinearDeferredTest, batch_free_of_parked_block) {
+    const MavhT mavh0(_linear_mavh);
+    auto ptr = linear_allocate(24);
+    auto other = linear_allocate(24);
+    ASSERT_NE(ptr, nullptr);
+    ASSERT_NE(other, nullptr);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+
+    // the parked blocks are coalesced first: the parked block is not deallocated twice
+    const std::vector<void*> ptrs = { ptr, other };
+    EXPECT_EQ(linear_deallocate_batch(ptrs.data(), ptrs.size()), -EINVAL);
+    EXPECT_EQ(MavhT(_linear_mavh), mavh0);
+    auto first = linear_allocate(24);
+    EXPECT_NE(linear_allocate(24), first);
+}
+
+TEST_F(LinearDeferredTest, reallocate_parked_block) {
+    auto ptr = linear_allocate(24);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+
+    // a parked block is not allocated
+    EXPECT_EQ(linear_reallocate(ptr, 100), nullptr);
+    EXPECT_EQ(linear_reallocate(ptr, 0), nullptr);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1);
+    EXPECT_EQ(linear_allocate(24), ptr);
+    EXPECT_NE(linear_allocate(24), ptr);
+}
+
+TEST_F(LinearDeferredTest, other_allocation_failures_coalesce) {
+    const MavhT mavh0(_linear_mavh);
+    const auto fill = [&mavh0]() {
+        EXPECT_EQ(linear_init_with_options(2'000'000, LINEAR_DEFERRED), 0);
+        std::vector<uint8_t*> ptrs;
+        for (int i = 0; i < 16; ++i) {
+            ptrs.push_back(static_cast<uint8_t*>(linear_allocate(128)));
+        }
+        EXPECT_NE(linear_allocate(mavh0.MemSz() - 16 * 128), nullptr);
+        EXPECT_EQ(MavhT(_linear_mavh).NumFree(), 0);
+        return ptrs;
+    };
+
+    // only the parked blocks together have room for them
+    linear_deinit();
+    auto ptrs = fill();
+    for (auto ptr : ptrs) {
+        EXPECT_EQ(linear_deallocate(ptr), 0);
+    }
+    const auto aligned = static_cast<uint8_t*>(linear_allocate_aligned(1024, 1024));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 1024, 0);
+    EXPECT_GE(aligned, ptrs.back());
+    EXPECT_LT(aligned, ptrs.front());
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1); // the lower 26 bits of 2^26 + 1
+
+    linear_deinit();
+    ptrs = fill();
+    for (auto ptr : ptrs) {
+        EXPECT_EQ(linear_deallocate(ptr), 0);
+    }
+    const std::vector<uint64_t> sizes = { 1024, 0, 1024 };
+    std::vector<void*> batch(sizes.size());
+    EXPECT_EQ(linear_allocate_batch(sizes.data(), sizes.size(), batch.data()), 0);
+    EXPECT_EQ(batch[0], ptrs.back() + 1024);
+    EXPECT_EQ(batch[1], nullptr);
+    EXPECT_EQ(batch[2], ptrs.back());
+    EXPECT_EQ(MavhT(_linear_mavh).NumFree(), 0);
+
+    linear_deinit();
+    ptrs = fill();
+    for (size_t i = 1; i < ptrs.size(); ++i) {
+        EXPECT_EQ(linear_deallocate(ptrs[i]), 0);
+    }
+    std::fill_n(ptrs[0], 128, 'x');
+    const auto moved = static_cast<uint8_t*>(linear_reallocate(ptrs[0], 15 * 128));
+    EXPECT_GE(moved, ptrs.back());
+    EXPECT_LT(moved, ptrs.front());
+    EXPECT_EQ(std::count(moved, moved + 128, 'x'), 128);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1); // the lower 26 bits of 2^26 + 1
+}
+
+TEST_F(LinearDeferredTest, reinit_forgets_quick_lists) {
+    auto ptr = linear_allocate(32);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+    linear_deinit();
+    EXPECT_EQ(linear_init_with_options(2'000'000, LINEAR_DEFERRED), 0);
+    // the parked block belonged to the previous pool
+    EXPECT_NE(linear_allocate(32), nullptr);
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 1);
+}
+
+class LinearPolicyTest : public MemoryTestBase {
+public:
+    void TearDown() override {
+        linear_deinit();
+        MemoryTestBase::TearDown();
+    }
+};
+
+TEST_F(LinearPolicyTest, best_fit) {
+    // holes of 48 and 40 bytes above the big free block
+    const auto holes = [](uint64_t options) {
+        EXPECT_EQ(linear_init_with_options(2'000'000, options), 0);
+        auto hole1 = linear_allocate(48);
+        linear_allocate(8);
+        auto hole2 = linear_allocate(40);
+        auto guard = static_cast<uint8_t*>(linear_allocate(8));
+        EXPECT_EQ(linear_deallocate(hole1), 0);
+        EXPECT_EQ(linear_deallocate(hole2), 0);
+        return std::make_pair(hole2, guard);
+    };
+
+    const auto [hole, guard] = holes(LINEAR_BEST_FIT);
+    EXPECT_EQ(linear_allocate(40), hole);
+    linear_deinit();
+
+    // no size class above 40 bytes but the one of the big block has free blocks
+    const auto [hole_bins, guard_bins] = holes(0);
+    EXPECT_EQ(linear_allocate(40), guard_bins - 40);
+}
+
+TEST_F(LinearPolicyTest, next_fit) {
+    // a block of 16 bytes where the previous search found a block and a big block below it
+    const auto rover = [](uint64_t options) {
+        EXPECT_EQ(linear_init_with_options(2'000'000, options), 0);
+        const MavhT mavh(_linear_mavh);
+        auto hole = static_cast<uint8_t*>(linear_allocate(64));
+        auto guard = static_cast<uint8_t*>(linear_allocate(8));
+        auto rest = linear_allocate(mavh.MemSz() - 72);
+        EXPECT_NE(rest, nullptr);
+        EXPECT_EQ(linear_deallocate(hole), 0);
+        EXPECT_EQ(linear_allocate(48), hole + 16);
+        EXPECT_EQ(linear_deallocate(rest), 0);
+        return std::make_pair(hole, guard);
+    };
+
+    const auto [hole, guard] = rover(LINEAR_NEXT_FIT);
+    EXPECT_EQ(linear_allocate(8), hole + 8);
+    linear_deinit();
+
+    const auto [hole_first, guard_first] = rover(LINEAR_FIRST_FIT);
+    EXPECT_EQ(linear_allocate(8), guard_first - 8);
+    linear_deinit();
+
+    const auto [hole_best, guard_best] = rover(LINEAR_BEST_FIT);
+    EXPECT_EQ(linear_allocate(8), hole_best + 8);
+}
+
+class LinearMappedTest : public ::testing::Test {
+public:
+    void SetUp() override {
+        // the pool is not the one of MemoryTestBase
+        _mem_pbase = nullptr;
+        _mem_size = 0;
+    }
+    void TearDown() override {
+        linear_deinit();
+        EXPECT_EQ(_mem_pbase, nullptr);
+        EXPECT_EQ(_mem_size, 0);
+    }
+};
+
+TEST_F(LinearMappedTest, init_and_deinit) {
+    ASSERT_EQ(linear_init_with_options(2'000'000, LINEAR_MMAP), 0);
+    ASSERT_NE(_mem_pbase, nullptr);
+    EXPECT_EQ(_mem_flags, MEM_MMAP);
+    EXPECT_GE(_mem_capacity, _mem_size);
+    const MavhT mavh(_linear_mavh);
+    EXPECT_EQ(mavh.MemSz(), mem_power_of_2_ceiling(2'000'000));
+    EXPECT_GE(_mem_size, mavh.FullSz());
+
+    auto ptr = static_cast<uint8_t*>(linear_allocate_filled(1000, '+'));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(std::count(ptr, ptr + 1000, '+'), 1000);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+
+    // the pages go back to the OS
+    linear_deinit();
+    EXPECT_EQ(_mem_pbase, nullptr);
+    EXPECT_EQ(_mem_capacity, 0);
+    EXPECT_EQ(_mem_flags, 0);
+
+    // transparent huge pages are advised for the pages of the pool
+    ASSERT_EQ(linear_init_with_options(2'000'000, LINEAR_MMAP | LINEAR_HUGEPAGES), 0);
+    EXPECT_EQ(_mem_flags, MEM_MMAP | MEM_HUGEPAGES);
+}
+
+TEST_F(LinearMappedTest, init_fails) {
+    // already initialized: the pool is not mapped again
+    ASSERT_EQ(linear_init_with_options(2'000'000, LINEAR_MMAP), 0);
+    const auto pbase = _mem_pbase;
+    EXPECT_EQ(linear_init_with_options(2'000'000, LINEAR_MMAP), -EBUSY);
+    EXPECT_EQ(_mem_pbase, pbase);
+    EXPECT_EQ(_linear_options, LINEAR_MMAP);
+    linear_deinit();
+
+    // a brk pool (kept by linear_deinit) is in the way of the mapping
+    std::vector<uint8_t> brk_pool(0x40'0000);
+    _mem_pbase = brk_pool.data();
+    _mem_size = brk_pool.size();
+    EXPECT_EQ(linear_init_with_options(2'000'000, LINEAR_MMAP), -EBUSY);
+    EXPECT_EQ(_linear_mavh, 0);
+    EXPECT_EQ(_linear_options, 0);
+    linear_deinit();
+    EXPECT_EQ(_mem_pbase, brk_pool.data());
+    EXPECT_EQ(_mem_size, brk_pool.size());
+
+    // it is used again by a linear_init without LINEAR_MMAP
+    ASSERT_EQ(linear_init(2'000'000), 0);
+    EXPECT_EQ(_linear_options, 0);
+    auto ptr = static_cast<uint8_t*>(linear_allocate(8));
+    EXPECT_GE(ptr, brk_pool.data());
+    EXPECT_LT(ptr, brk_pool.data() + brk_pool.size());
+    linear_deinit();
+    EXPECT_EQ(_mem_pbase, brk_pool.data());
+
+    _mem_pbase = nullptr;
+    _mem_size = 0;
+}
+
+TEST_F(LinearMappedTest, mav_grows_in_place) {
+    ASSERT_EQ(linear_init_with_options(0x10'0000, LINEAR_MMAP), 0);
+    const auto pbase = _mem_pbase;
+    const MavhT mavh0(_linear_mavh);
+    std::vector<uint8_t*> ptrs;
+    while (MavhT(_linear_mavh).MavSz() < 4 * mavh0.MavSz()) {
+        auto ptr = static_cast<uint8_t*>(linear_allocate_filled(16, 'a' + ptrs.size() % 26));
+        ASSERT_NE(ptr, nullptr);
+        ptrs.push_back(ptr);
+    }
+    EXPECT_EQ(_mem_pbase, pbase);
+    EXPECT_GE(_mem_size, MavhT(_linear_mavh).FullSz());
+    for (size_t i = 0; i < ptrs.size(); ++i) {
+        EXPECT_EQ(std::count(ptrs[i], ptrs[i] + 16, 'a' + i % 26), 16) << i;
+        EXPECT_EQ(linear_deallocate(ptrs[i]), 0);
+    }
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 0);
+}
+
+TEST_F(LinearMappedTest, allocate_filled_fills_the_unit) {
+    constexpr uint64_t GB = uint64_t(1) << 30;
+    if (linear_init_with_options(32 * GB, LINEAR_MMAP) != 0) {
+        GTEST_SKIP() << "the system did not give 32 GB of address space";
+    }
+    ASSERT_EQ(_linear_get_msh_unit(_linear_mavh), 4);
+
+    // the block of 8 bytes has 16 bytes: the 8 bytes after the ones asked for are filled too
+    auto ptr = static_cast<uint8_t*>(linear_allocate_filled(16, '*'));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+    ASSERT_EQ(linear_allocate_filled(8, '+'), ptr);
+    EXPECT_EQ(std::count(ptr, ptr + 16, '+'), 16);
+    EXPECT_EQ(linear_deallocate(ptr), 0);
+}
+
+TEST_F(LinearMappedTest, trim) {
+    ASSERT_EQ(linear_init_with_options(0x40'0000, LINEAR_MMAP), 0);
+    EXPECT_EQ(linear_trim(), 0);
+    const MavhT mavh0(_linear_mavh);
+    const uint64_t size0 = _mem_size;
+
+    // a burst of small blocks makes MAV grow, a big block is filled
+    std::vector<uint8_t*> ptrs;
+    while (MavhT(_linear_mavh).MavSz() < 32 * mavh0.MavSz()) {
+        auto ptr = static_cast<uint8_t*>(linear_allocate_filled(16, 'a' + ptrs.size() % 26));
+        ASSERT_NE(ptr, nullptr);
+        ptrs.push_back(ptr);
+    }
+    auto big = static_cast<uint8_t*>(linear_allocate_filled(0x10'0000, '+'));
+    ASSERT_NE(big, nullptr);
+    EXPECT_GT(_mem_size, size0);
+
+    // MAV full enough is not halved
+    EXPECT_EQ(linear_trim(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).MavSz(), 32 * mavh0.MavSz());
+
+    // after the burst MAV and the pool go back to their size
+    for (size_t i = 10; i < ptrs.size(); ++i) {
+        EXPECT_EQ(linear_deallocate(ptrs[i]), 0);
+    }
+    ptrs.resize(10);
+    EXPECT_EQ(linear_deallocate(big), 0);
+    EXPECT_EQ(linear_trim(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).MavSz(), mavh0.MavSz());
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), ptrs.size());
+    EXPECT_EQ(_mem_size, size0);
+    for (size_t i = 0; i < ptrs.size(); ++i) {
+        EXPECT_EQ(std::count(ptrs[i], ptrs[i] + 16, 'a' + i % 26), 16) << i;
+    }
+
+    // the pages inside the big free block were given back (they read as 0)
+    const auto page = reinterpret_cast<uint8_t*>(
+          (reinterpret_cast<uintptr_t>(big) + 0x1'0000) & ~uintptr_t{ 0xffff });
+    EXPECT_EQ(std::count(page, page + 0x1'0000, 0), 0x1'0000);
+
+    // the pool works as before
+    big = static_cast<uint8_t*>(linear_allocate_filled(0x10'0000, '*'));
+    ASSERT_NE(big, nullptr);
+    EXPECT_EQ(std::count(big, big + 0x10'0000, '*'), 0x10'0000);
+    EXPECT_EQ(linear_deallocate(big), 0);
+    for (auto ptr : ptrs) {
+        EXPECT_EQ(linear_deallocate(ptr), 0);
+    }
+    EXPECT_EQ(MavhT(_linear_mavh).NumUsed(), 0);
+    EXPECT_EQ(MavhT(_linear_mavh).NumFree(), 1);
+}
+
+TEST(LinearArenaTest, arenas_are_independent) {
+    linear_arena arena1;
+    linear_arena arena2;
+    ASSERT_EQ(linear_arena_create(&arena1, 0x10'0000), 0);
+    ASSERT_EQ(linear_arena_create(&arena2, 0x1'0000), 0);
+    ASSERT_NE(arena1.pool.pbase, nullptr);
+    ASSERT_NE(arena2.pool.pbase, nullptr);
+    EXPECT_NE(arena1.pool.pbase, arena2.pool.pbase);
+    EXPECT_EQ(arena1.pool.flags, MEM_MMAP);
+    EXPECT_EQ(MavhT(arena1.mavh).MemSz(), 0x10'0000);
+    EXPECT_EQ(MavhT(arena2.mavh).MemSz(), 0x1'0000);
+    EXPECT_EQ(MavhT(arena1.mavh).NumFree(), 1);
+
+    auto ptr1 = static_cast<uint8_t*>(linear_arena_allocate(&arena1, 100));
+    auto ptr2 = static_cast<uint8_t*>(linear_arena_allocate(&arena2, 100));
+    ASSERT_NE(ptr1, nullptr);
+    ASSERT_NE(ptr2, nullptr);
+    EXPECT_EQ(ptr1, arena1.pool.pbase);
+    EXPECT_EQ(ptr2, arena2.pool.pbase);
+    EXPECT_EQ(MavhT(arena1.mavh).NumUsed(), 1);
+    EXPECT_EQ(MavhT(arena2.mavh).NumUsed(), 1);
+
+    // a block belongs to the arena it was allocated from
+    EXPECT_NE(linear_arena_deallocate(&arena1, ptr2), 0);
+    EXPECT_EQ(linear_arena_deallocate(&arena2, ptr2), 0);
+    EXPECT_EQ(MavhT(arena2.mavh).NumUsed(), 0);
+    EXPECT_EQ(MavhT(arena1.mavh).NumUsed(), 1);
+
+    // all blocks go away with the arena
+    EXPECT_EQ(linear_arena_destroy(&arena1), 0);
+    EXPECT_EQ(arena1.pool.pbase, nullptr);
+    EXPECT_EQ(arena1.mavh, 0);
+    EXPECT_EQ(linear_arena_destroy(&arena2), 0);
+    EXPECT_EQ(arena2.pool.pbase, nullptr);
+}
+
+TEST(LinearArenaTest, mav_grows_in_place) {
+    linear_arena arena;
+    ASSERT_EQ(linear_arena_create(&arena, 0x10'0000), 0);
+    const auto pbase = arena.pool.pbase;
+    const MavhT mavh0(arena.mavh);
+    std::vector<uint8_t*> ptrs;
+    while (MavhT(arena.mavh).MavSz() < 4 * mavh0.MavSz()) {
+        auto ptr = static_cast<uint8_t*>(linear_arena_allocate(&arena, 16));
+        ASSERT_NE(ptr, nullptr);
+        std::fill(ptr, ptr + 16, 'a' + ptrs.size() % 26);
+        ptrs.push_back(ptr);
+    }
+    EXPECT_EQ(arena.pool.pbase, pbase);
+    EXPECT_GE(arena.pool.size, MavhT(arena.mavh).FullSz());
+    for (size_t i = 0; i < ptrs.size(); i += 2) {
+        EXPECT_EQ(std::count(ptrs[i], ptrs[i] + 16, 'a' + i % 26), 16) << i;
+        EXPECT_EQ(linear_arena_deallocate(&arena, ptrs[i]), 0);
+    }
+    EXPECT_EQ(MavhT(arena.mavh).NumUsed(), ptrs.size() / 2);
+    // the other half is freed with the arena
+    EXPECT_EQ(linear_arena_destroy(&arena), 0);
+}
+
+TEST(LinearArenaTest, trim) {
+    linear_arena arena;
+    ASSERT_EQ(linear_arena_create(&arena, 0x10'0000), 0);
+    const MavhT mavh0(arena.mavh);
+    const uint64_t size0 = arena.pool.size;
+    std::vector<void*> ptrs;
+    while (MavhT(arena.mavh).MavSz() < 32 * mavh0.MavSz()) {
+        ptrs.push_back(linear_arena_allocate(&arena, 16));
+        ASSERT_NE(ptrs.back(), nullptr);
+    }
+    EXPECT_GT(arena.pool.size, size0);
+    for (auto ptr : ptrs) {
+        EXPECT_EQ(linear_arena_deallocate(&arena, ptr), 0);
+    }
+    EXPECT_EQ(linear_arena_trim(&arena), 0);
+    EXPECT_EQ(MavhT(arena.mavh).MavSz(), mavh0.MavSz());
+    EXPECT_EQ(arena.pool.size, size0);
+    EXPECT_EQ(linear_arena_destroy(&arena), 0);
+    EXPECT_EQ(linear_arena_trim(&arena), -EINVAL);
+}
+
+TEST(LinearArenaTest, wide_pool) {
+    constexpr uint64_t GB = uint64_t(1) << 30;
+    linear_arena arena;
+    if (linear_arena_create(&arena, 32 * GB) != 0) {
+        GTEST_SKIP() << "the system did not give 32 GB of address space";
     }
+    EXPECT_EQ(MavhT(arena.mavh).MemSz(), 32 * GB);
+    EXPECT_EQ(_linear_get_msh_unit(arena.mavh), 4);
+
+    // blocks are made of 16 bytes units and may be beyond 16 GB
+    auto ptr1 = static_cast<uint8_t*>(linear_arena_allocate(&arena, 20 * GB));
+    auto ptr2 = static_cast<uint8_t*>(linear_arena_allocate(&arena, 8));
+    auto ptr3 = static_cast<uint8_t*>(linear_arena_allocate(&arena, 24));
+    ASSERT_NE(ptr1, nullptr);
+    ASSERT_NE(ptr2, nullptr);
+    ASSERT_NE(ptr3, nullptr);
+    EXPECT_EQ(ptr1 - ptr2, 16);
+    EXPECT_EQ(ptr2 - ptr3, 32);
+    EXPECT_EQ(ptr1 + 20 * GB, arena.pool.pbase + 32 * GB);
+    std::fill(ptr3, ptr3 + 24, 'w');
+
+    linear_statistics stats;
+    ASSERT_EQ(linear_arena_stats(&arena, &stats), 0);
+    EXPECT_EQ(stats.used_bytes, 20 * GB + 48);
+    EXPECT_EQ(stats.used_blocks, 3);
+
+    EXPECT_EQ(linear_arena_deallocate(&arena, ptr2), 0);
+    EXPECT_EQ(linear_arena_deallocate(&arena, ptr1), 0);
+    ASSERT_EQ(linear_arena_stats(&arena, &stats), 0);
+    EXPECT_EQ(stats.used_bytes, 32);
+    EXPECT_EQ(stats.free_blocks, 2);
+    EXPECT_EQ(stats.largest_free_block, 20 * GB + 16);
+    EXPECT_EQ(std::count(ptr3, ptr3 + 24, 'w'), 24);
+    EXPECT_EQ(linear_arena_destroy(&arena), 0);
 }
 
 }
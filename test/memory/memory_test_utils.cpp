@@ -1,5 +1,7 @@
 #include "memory_test_utils.h"
 
+#include <sys/mman.h>
+
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
@@ -39,6 +41,20 @@ void Utils::Print(const uint8_t* pmem, size_t size) {
     std::cout << '\n';
 }
 
+mem_pool Utils::MapPoolWithRoomAfter(uint64_t capacity, uint64_t room) {
+    void* pbase = mmap(nullptr,
+          capacity + room,
+          PROT_NONE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+          -1,
+          0);
+    if (pbase == MAP_FAILED) {
+        return {};
+    }
+    munmap(static_cast<uint8_t*>(pbase) + capacity, room);
+    return { static_cast<uint8_t*>(pbase), 0, capacity, MEM_MMAP };
+}
+
 void MemoryTestBase::SetUp() {
     std::fill(std::begin(pool_), std::end(pool_), 'x');
     _mem_pbase = pool_;
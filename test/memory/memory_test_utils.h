@@ -29,6 +29,9 @@ public:
     static std::vector<uint8_t> RandomVector(size_t size, uint8_t min, uint8_t max);
     static void Print(std::ostream& out, const uint8_t* pmem, size_t size);
     static void Print(const uint8_t* pmem, size_t size);
+    // a pool like the ones of mem_pool_map with room bytes of free address space after it (so it
+    // can grow in place beyond its capacity)
+    static mem_pool MapPoolWithRoomAfter(uint64_t capacity, uint64_t room);
 
 private:
     static std::mt19937 gen_;
@@ -0,0 +1,189 @@
+#include "memory/buddy.h"
+#include "memory/linear.h"
+#include "memory/utils.h"
+#include "mtrace/trace.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+// the trace of $MTRACE_REPLAY (recorded with libmtrace_preload.so) or a synthetic one
+const mtrace::Trace& ReplayedTrace() {
+    static const mtrace::Trace trace = [] {
+        mtrace::Trace loaded;
+        const char* path = std::getenv("MTRACE_REPLAY");
+        if (path != nullptr && mtrace::ReadTrace(path, loaded)) {
+            return loaded;
+        }
+        if (path != nullptr) {
+            std::fprintf(stderr, "%s is not a trace: replaying a synthetic one\n", path);
+        }
+        return mtrace::SyntheticTrace(100'000, 4096);
+    }();
+    return trace;
+}
+
+// bytes of the process in memory
+uint64_t ResidentBytes() {
+    std::FILE* file = std::fopen("/proc/self/statm", "r");
+    if (file == nullptr) {
+        return 0;
+    }
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    const int read = std::fscanf(file, "%lu %lu", &size, &resident);
+    std::fclose(file);
+    return read == 2 ? resident * sysconf(_SC_PAGESIZE) : 0;
+}
+
+// a pool big enough for the trace (allocators that round the sizes up need some more)
+uint64_t PoolSize(const mtrace::Trace& trace, uint64_t factor) {
+    return std::max<uint64_t>(
+          mem_power_of_2_ceiling(factor * mtrace::PeakLiveBytes(trace)), 64 << 20);
+}
+
+// the allocators replaying a trace: a null block (the allocator ran out of memory) is skipped
+struct MallocReplay {
+    explicit MallocReplay(const mtrace::Trace&) {}
+    void* Allocate(uint64_t size) { return std::malloc(size); }
+    void Deallocate(void* ptr, uint64_t) { std::free(ptr); }
+    void* Reallocate(void* ptr, uint64_t, uint64_t size) { return std::realloc(ptr, size); }
+    uint64_t Fragmentation() { return 0; }
+};
+
+struct LinearReplay {
+    explicit LinearReplay(const mtrace::Trace& trace) {
+        linear_init_with_options(PoolSize(trace, 2), LINEAR_MMAP);
+    }
+    ~LinearReplay() { linear_deinit(); }
+    void* Allocate(uint64_t size) { return linear_allocate(size); }
+    void Deallocate(void* ptr, uint64_t) { linear_deallocate(ptr); }
+    void* Reallocate(void* ptr, uint64_t, uint64_t size) { return linear_reallocate(ptr, size); }
+    uint64_t Fragmentation() {
+        linear_statistics stats;
+        return linear_stats(&stats) == 0 ? stats.fragmentation : 0;
+    }
+};
+
+struct LinearArenaReplay {
+    explicit LinearArenaReplay(const mtrace::Trace& trace) {
+        linear_arena_create(&arena_, PoolSize(trace, 2));
+    }
+    ~LinearArenaReplay() { linear_arena_destroy(&arena_); }
+    void* Allocate(uint64_t size) { return linear_arena_allocate(&arena_, size); }
+    void Deallocate(void* ptr, uint64_t) { linear_arena_deallocate(&arena_, ptr); }
+    void* Reallocate(void* ptr, uint64_t, uint64_t size) {
+        return linear_arena_reallocate(&arena_, ptr, size);
+    }
+    uint64_t Fragmentation() {
+        linear_statistics stats;
+        return linear_arena_stats(&arena_, &stats) == 0 ? stats.fragmentation : 0;
+    }
+
+    linear_arena arena_;
+};
+
+// buddy blocks are powers of 2 and can not be reallocated in place: allocate, copy and free
+struct BuddyReplay {
+    explicit BuddyReplay(const mtrace::Trace& trace) { buddy_init(&buddy_, PoolSize(trace, 4)); }
+    ~BuddyReplay() { buddy_deinit(&buddy_); }
+    void* Allocate(uint64_t size) { return buddy_allocate(&buddy_, size); }
+    void Deallocate(void* ptr, uint64_t) { buddy_deallocate(&buddy_, ptr); }
+    void* Reallocate(void* ptr, uint64_t old_size, uint64_t size) {
+        void* new_ptr = buddy_allocate(&buddy_, size);
+        if (new_ptr != nullptr) {
+            std::memcpy(new_ptr, ptr, std::min(old_size, size));
+            buddy_deallocate(&buddy_, ptr);
+        }
+        return new_ptr;
+    }
+    uint64_t Fragmentation() { return 0; }
+
+    buddy buddy_;
+};
+
+struct ReplayResult {
+    uint64_t peak_rss = 0;           // bytes the process grew while replaying
+    uint64_t peak_fragmentation = 0; // ppm
+};
+
+// replay the trace once in a fresh allocator (peak RSS and fragmentation only if sampled)
+template <typename Allocator>
+ReplayResult ReplayTrace(const mtrace::Trace& trace, bool sample) {
+    constexpr size_t SAMPLE_PERIOD = 256;
+    std::vector<void*> ptrs(trace.num_slots, nullptr);
+    std::vector<uint64_t> sizes(trace.num_slots, 0);
+    ReplayResult result;
+    const uint64_t rss_before = sample ? ResidentBytes() : 0;
+    Allocator allocator(trace);
+    for (size_t i = 0; i < trace.events.size(); ++i) {
+        const auto& event = trace.events[i];
+        void*& ptr = ptrs[event.slot];
+        switch (event.kind) {
+            case mtrace::EventKind::ALLOCATE:
+                ptr = allocator.Allocate(event.size);
+                break;
+            case mtrace::EventKind::DEALLOCATE:
+                if (ptr != nullptr) {
+                    allocator.Deallocate(ptr, sizes[event.slot]);
+                }
+                ptr = nullptr;
+                break;
+            case mtrace::EventKind::REALLOCATE:
+                ptr = ptr == nullptr ? allocator.Allocate(event.size)
+                                     : allocator.Reallocate(ptr, sizes[event.slot], event.size);
+                break;
+        }
+        sizes[event.slot] = event.size;
+        benchmark::DoNotOptimize(ptr);
+        if (sample && i % SAMPLE_PERIOD == 0) {
+            const uint64_t rss = ResidentBytes();
+            result.peak_rss = std::max(result.peak_rss, rss > rss_before ? rss - rss_before : 0);
+            result.peak_fragmentation =
+                  std::max(result.peak_fragmentation, allocator.Fragmentation());
+        }
+    }
+    for (size_t slot = 0; slot < ptrs.size(); ++slot) {
+        if (ptrs[slot] != nullptr) {
+            allocator.Deallocate(ptrs[slot], sizes[slot]);
+        }
+    }
+    return result;
+}
+
+// replay the whole trace every iteration (the peak RSS and fragmentation are sampled in a replay
+// out of the timing)
+template <typename Allocator>
+void BM_Replay(benchmark::State& state) {
+    const auto& trace = ReplayedTrace();
+    uint64_t elapsed_ns = 0;
+    for (auto _ : state) {
+        const auto start = std::chrono::steady_clock::now();
+        ReplayTrace<Allocator>(trace, false);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        elapsed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+    const uint64_t num_events = state.iterations() * trace.events.size();
+    const auto sampled = ReplayTrace<Allocator>(trace, true);
+    state.counters["ns_per_op"] = num_events ? static_cast<double>(elapsed_ns) / num_events : 0;
+    state.counters["peak_rss_bytes"] = static_cast<double>(sampled.peak_rss);
+    state.counters["peak_live_bytes"] = static_cast<double>(mtrace::PeakLiveBytes(trace));
+    state.counters["peak_fragmentation_ppm"] = static_cast<double>(sampled.peak_fragmentation);
+    state.SetItemsProcessed(num_events);
+}
+
+BENCHMARK_TEMPLATE(BM_Replay, MallocReplay)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Replay, LinearReplay)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Replay, LinearArenaReplay)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Replay, BuddyReplay)->Unit(benchmark::kMillisecond);
+} // namespace
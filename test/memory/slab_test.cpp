@@ -0,0 +1,101 @@
+#include "memory/slab.h"
+#include "memory/utils.h"
+
+#include <errno.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace memory {
+namespace {
+
+class SlabTest : public ::testing::TestWithParam<uint64_t> {
+public:
+    void SetUp() override { ASSERT_EQ(slab_init(&slab_, GetParam(), 0x100'0000), 0); }
+    void TearDown() override {
+        EXPECT_EQ(slab_deinit(&slab_), 0);
+        EXPECT_EQ(slab_.pool.pbase, nullptr);
+        EXPECT_EQ(slab_.free, nullptr);
+        EXPECT_EQ(slab_.top, 0);
+    }
+
+protected:
+    slab slab_;
+};
+
+TEST_P(SlabTest, init) {
+    ASSERT_NE(slab_.pool.pbase, nullptr);
+    EXPECT_EQ(slab_.pool.flags, MEM_MMAP);
+    EXPECT_EQ(slab_.slot_sz, GetParam());
+    EXPECT_EQ(slab_.free, nullptr);
+    EXPECT_EQ(slab_.top, 0);
+}
+
+TEST_P(SlabTest, allocate_consecutive_slots) {
+    const uint64_t slot_sz = GetParam();
+    std::vector<uint8_t*> ptrs;
+    for (uint64_t i = 0; i < 10'000; ++i) {
+        auto ptr = static_cast<uint8_t*>(slab_allocate(&slab_));
+        ASSERT_EQ(ptr, slab_.pool.pbase + i * slot_sz) << i;
+        std::fill_n(ptr, slot_sz, 'a' + i % 26);
+        ptrs.push_back(ptr);
+    }
+    EXPECT_EQ(slab_.top, 10'000 * slot_sz);
+    EXPECT_GE(slab_.pool.size, slab_.top);
+    for (uint64_t i = 0; i < ptrs.size(); ++i) {
+        EXPECT_EQ(std::count(ptrs[i], ptrs[i] + slot_sz, 'a' + i % 26), slot_sz) << i;
+    }
+}
+
+TEST_P(SlabTest, freed_slots_are_reused) {
+    std::vector<void*> ptrs;
+    for (uint64_t i = 0; i < 100; ++i) {
+        ptrs.push_back(slab_allocate(&slab_));
+    }
+    const auto top = slab_.top;
+    for (uint64_t i = 0; i < ptrs.size(); i += 3) {
+        EXPECT_EQ(slab_deallocate(&slab_, ptrs[i]), 0);
+    }
+    // last freed, first allocated
+    EXPECT_EQ(slab_.free, ptrs[99]);
+    std::set<void*> reused;
+    for (uint64_t i = 0; i < ptrs.size(); i += 3) {
+        reused.insert(slab_allocate(&slab_));
+    }
+    EXPECT_EQ(slab_.free, nullptr);
+    EXPECT_EQ(slab_.top, top);
+    EXPECT_EQ(reused.size(), 34);
+    for (uint64_t i = 0; i < ptrs.size(); i += 3) {
+        EXPECT_EQ(reused.count(ptrs[i]), 1) << i;
+    }
+    // then the slots never used
+    EXPECT_EQ(slab_allocate(&slab_), slab_.pool.pbase + top);
+}
+
+TEST_P(SlabTest, deallocate_out_of_slab) {
+    auto ptr = static_cast<uint8_t*>(slab_allocate(&slab_));
+    EXPECT_EQ(slab_deallocate(&slab_, nullptr), -EINVAL);
+    EXPECT_EQ(slab_deallocate(&slab_, ptr + slab_.top), -EINVAL); // never allocated
+    EXPECT_EQ(slab_deallocate(&slab_, ptr - 8), -EINVAL);
+    EXPECT_EQ(slab_deallocate(&slab_, ptr + 8), -EINVAL); // not the begin of a slot
+    EXPECT_EQ(slab_.free, nullptr);
+    EXPECT_EQ(slab_deallocate(&slab_, ptr), 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(SlotSizes, SlabTest, ::testing::Values(32, 64, 128));
+
+TEST(SlabInitTest, slot_size) {
+    slab slab1;
+    EXPECT_EQ(slab_init(&slab1, 0, 0x10'0000), -EINVAL);
+    EXPECT_EQ(slab1.pool.pbase, nullptr);
+    ASSERT_EQ(slab_init(&slab1, 13, 0x10'0000), 0);
+    EXPECT_EQ(slab1.slot_sz, 16);
+    EXPECT_EQ(slab_deinit(&slab1), 0);
+    EXPECT_EQ(slab_allocate(&slab1), nullptr);
+}
+
+}
+}
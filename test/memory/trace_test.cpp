@@ -0,0 +1,137 @@
+#include "mtrace/trace.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace mtrace {
+namespace {
+
+class TraceTest : public ::testing::Test {
+public:
+    void TearDown() override { std::remove(path_.c_str()); }
+
+protected:
+    const std::string path_ = ::testing::TempDir() + "trace_test.mtrace";
+};
+
+TEST_F(TraceTest, write_read) {
+    Trace trace;
+    trace.events = {
+        { 0, EventKind::ALLOCATE, 0, 16 },
+        { 10, EventKind::ALLOCATE, 1, 1 << 20 },
+        { 10, EventKind::REALLOCATE, 0, 100 },
+        { 300, EventKind::DEALLOCATE, 1, 0 },
+        { uint64_t{ 1 } << 40, EventKind::ALLOCATE, 200'000, uint64_t{ 1 } << 35 },
+    };
+    trace.num_slots = 200'001;
+    ASSERT_TRUE(WriteTrace(path_, trace));
+
+    Trace read;
+    ASSERT_TRUE(ReadTrace(path_, read));
+    EXPECT_EQ(read.events, trace.events);
+    EXPECT_EQ(read.num_slots, trace.num_slots);
+}
+
+TEST_F(TraceTest, encoding_is_compact) {
+    std::vector<uint8_t> out;
+    EncodeEvent(out, 100, { 100, EventKind::ALLOCATE, 5, 64 });
+    EXPECT_EQ(out, (std::vector<uint8_t>{ 100, 5 << 2, 64 }));
+
+    out.clear();
+    EncodeEvent(out, 1000, { 1100, EventKind::DEALLOCATE, 5, 0 });
+    EXPECT_EQ(out, (std::vector<uint8_t>{ 0xe8, 0x07, 5 << 2 | 1 }));
+}
+
+TEST_F(TraceTest, read_not_a_trace) {
+    Trace trace;
+    EXPECT_FALSE(ReadTrace(path_, trace)); // no file
+
+    std::FILE* file = std::fopen(path_.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    const char header[] = { 'M', 'T', 'R', 'X', 1, 0, 0, 0 };
+    std::fwrite(header, 1, sizeof(header), file);
+    std::fclose(file);
+    EXPECT_FALSE(ReadTrace(path_, trace));
+
+    // truncated event
+    ASSERT_TRUE(WriteTrace(path_, { { { 0, EventKind::ALLOCATE, 0, 1000 } }, 1 }));
+    file = std::fopen(path_.c_str(), "rb+");
+    ASSERT_NE(file, nullptr);
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fclose(file);
+    ASSERT_EQ(truncate(path_.c_str(), size - 1), 0);
+    EXPECT_FALSE(ReadTrace(path_, trace));
+}
+
+TEST_F(TraceTest, recorder) {
+    {
+        TraceRecorder recorder(path_);
+        ASSERT_TRUE(recorder.IsOpen());
+        int a, b, c;
+        recorder.Allocated(&a, 10);
+        recorder.Allocated(&b, 20);
+        recorder.Deallocated(&a);
+        recorder.Deallocated(&c); // not recorded: ignored
+        recorder.Allocated(&c, 30);
+        recorder.Reallocated(&b, &a, 40);
+        recorder.Deallocated(&a);
+        recorder.Allocated(nullptr, 50); // failed allocation: ignored
+    }
+
+    Trace trace;
+    ASSERT_TRUE(ReadTrace(path_, trace));
+    ASSERT_EQ(trace.events.size(), 6u);
+    const EventKind kinds[] = {
+        EventKind::ALLOCATE,   EventKind::ALLOCATE,   EventKind::DEALLOCATE,
+        EventKind::ALLOCATE,   EventKind::REALLOCATE, EventKind::DEALLOCATE,
+    };
+    // the slot of a freed block is reused and a reallocated block keeps its slot
+    const uint32_t slots[] = { 0, 1, 0, 0, 1, 1 };
+    const uint64_t sizes[] = { 10, 20, 0, 30, 40, 0 };
+    for (size_t i = 0; i < trace.events.size(); ++i) {
+        EXPECT_EQ(trace.events[i].kind, kinds[i]) << i;
+        EXPECT_EQ(trace.events[i].slot, slots[i]) << i;
+        EXPECT_EQ(trace.events[i].size, sizes[i]) << i;
+        if (i > 0) {
+            EXPECT_GE(trace.events[i].time_ns, trace.events[i - 1].time_ns) << i;
+        }
+    }
+    EXPECT_EQ(trace.num_slots, 2u);
+}
+
+TEST_F(TraceTest, synthetic_trace) {
+    const auto trace = SyntheticTrace(10'000, 256);
+    ASSERT_EQ(trace.events.size(), 10'000u);
+    EXPECT_EQ(trace.num_slots, 256u);
+    std::vector<bool> used(trace.num_slots, false);
+    for (const auto& event : trace.events) {
+        ASSERT_LT(event.slot, trace.num_slots);
+        // a slot is only freed if it has a block and only allocated if it has none
+        EXPECT_EQ(used[event.slot], event.kind == EventKind::DEALLOCATE);
+        used[event.slot] = event.kind != EventKind::DEALLOCATE;
+    }
+    EXPECT_GT(PeakLiveBytes(trace), 0u);
+}
+
+TEST_F(TraceTest, peak_live_bytes) {
+    Trace trace;
+    trace.events = {
+        { 0, EventKind::ALLOCATE, 0, 100 },
+        { 0, EventKind::ALLOCATE, 1, 50 },
+        { 0, EventKind::DEALLOCATE, 0, 0 },
+        { 0, EventKind::REALLOCATE, 1, 120 },
+        { 0, EventKind::ALLOCATE, 0, 10 },
+        { 0, EventKind::DEALLOCATE, 1, 0 },
+    };
+    trace.num_slots = 2;
+    EXPECT_EQ(PeakLiveBytes(trace), 150u);
+}
+}
+}
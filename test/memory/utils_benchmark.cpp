@@ -0,0 +1,93 @@
+#include "memory/utils.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// the paths of mem_fill_n / mem_copy_n are chosen by the features in state.range(1) (0 is NEON);
+// the buffers start OFFSET bytes past the data of the vectors to have unaligned heads and tails
+constexpr uint64_t MAX_SIZE = 64 << 20;
+constexpr uint64_t OFFSET = 3;
+
+// the features of the processor, saved before any benchmark restricts them
+uint64_t ProcessorFeatures() {
+    static const uint64_t features = mem_features();
+    return features;
+}
+
+bool UseFeatures(benchmark::State& state) {
+    const uint64_t features = state.range(1);
+    if ((ProcessorFeatures() & features) != features) {
+        state.SkipWithError("the processor does not have the features");
+        return false;
+    }
+    mem_set_features(features);
+    return true;
+}
+
+void BM_MemFill(benchmark::State& state) {
+    const uint64_t size = state.range(0);
+    std::vector<uint8_t> buffer(size + OFFSET);
+    if (!UseFeatures(state)) {
+        return;
+    }
+    for (auto _ : state) {
+        mem_fill_n(buffer.data() + OFFSET, size, '\0');
+        benchmark::ClobberMemory();
+    }
+    mem_set_features(ProcessorFeatures());
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+void BM_Memset(benchmark::State& state) {
+    const uint64_t size = state.range(0);
+    std::vector<uint8_t> buffer(size + OFFSET);
+    for (auto _ : state) {
+        std::memset(buffer.data() + OFFSET, '\0', size);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+void BM_MemCopy(benchmark::State& state) {
+    const uint64_t size = state.range(0);
+    std::vector<uint8_t> src(size + OFFSET, 'a');
+    std::vector<uint8_t> dst(size + OFFSET);
+    if (!UseFeatures(state)) {
+        return;
+    }
+    for (auto _ : state) {
+        mem_copy_n(src.data() + OFFSET, size, dst.data() + OFFSET);
+        benchmark::ClobberMemory();
+    }
+    mem_set_features(ProcessorFeatures());
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+void BM_Memcpy(benchmark::State& state) {
+    const uint64_t size = state.range(0);
+    std::vector<uint8_t> src(size + OFFSET, 'a');
+    std::vector<uint8_t> dst(size + OFFSET);
+    for (auto _ : state) {
+        std::memcpy(dst.data() + OFFSET, src.data() + OFFSET, size);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+// sizes from 1 byte to 64 MB
+BENCHMARK(BM_MemFill)->ArgsProduct({
+      benchmark::CreateRange(1, MAX_SIZE, 4),
+      { 0, MEM_FEATURE_ZVA, MEM_FEATURE_SVE | MEM_FEATURE_ZVA },
+});
+BENCHMARK(BM_Memset)->RangeMultiplier(4)->Range(1, MAX_SIZE);
+BENCHMARK(BM_MemCopy)->ArgsProduct({
+      benchmark::CreateRange(1, MAX_SIZE, 4),
+      { 0, MEM_FEATURE_SVE },
+});
+BENCHMARK(BM_Memcpy)->RangeMultiplier(4)->Range(1, MAX_SIZE);
+} // namespace
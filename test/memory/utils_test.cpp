@@ -3,6 +3,7 @@
 #include "memory/utils.h"
 
 #include <gtest/gtest.h>
+#include <sys/mman.h>
 
 #include <algorithm>
 #include <cstdint>
@@ -490,5 +491,194 @@ TEST_F(MemoryUtilsTest, copy_n_backward_overlap) {
     }
 }
 
+TEST_F(MemoryUtilsTest, fill_n_and_copy_n_features) {
+    const uint64_t features = mem_features();
+    EXPECT_EQ(features & ~(MEM_FEATURE_SVE | MEM_FEATURE_ZVA), 0u);
+
+    std::vector<uint64_t> sizes(300);
+    std::iota(sizes.begin(), sizes.end(), 0);
+    sizes.insert(sizes.end(), { 1'023, 1'024, 1'025, 4'097, 65'536, 70'001 });
+
+    // every subset of the features of the processor (0 is NEON only)
+    for (uint64_t subset = 0; subset <= features; ++subset) {
+        if ((subset & features) != subset) {
+            continue;
+        }
+        ASSERT_EQ(mem_set_features(subset), subset);
+        EXPECT_EQ(mem_features(), subset);
+        for (auto size : sizes) {
+            const size_t offset = size % 16;
+            SCOPED_TRACE(
+                  "features = " + std::to_string(subset) + " / size = " + std::to_string(size));
+            for (char c : { '\0', '+' }) {
+                std::vector<uint8_t> buffer(size + 32, '-');
+                std::vector<uint8_t> expected = buffer;
+                mem_fill_n(buffer.data() + offset, size, c);
+                std::fill_n(expected.begin() + offset, size, c);
+                EXPECT_EQ(buffer, expected);
+            }
+
+            const auto src = Utils::RandomVector(size + 32, 'a', 'z');
+            std::vector<uint8_t> dst(size + 32, '-');
+            std::vector<uint8_t> expected = dst;
+            mem_copy_n(src.data() + 3, size, dst.data() + offset);
+            std::copy_n(src.begin() + 3, size, expected.begin() + offset);
+            EXPECT_EQ(dst, expected);
+        }
+    }
+    EXPECT_EQ(mem_set_features(features), features);
+}
+
+TEST(MemoryPoolTest, map_reserve_unmap) {
+    mem_pool pool = {};
+    ASSERT_EQ(mem_pool_map(&pool, 0x10'0000, 0), 0);
+    ASSERT_NE(pool.pbase, nullptr);
+    EXPECT_EQ(pool.size, 0);
+    EXPECT_EQ(pool.capacity, 0x10'0000);
+    EXPECT_EQ(pool.flags, MEM_MMAP);
+    const auto pbase = pool.pbase;
+
+    // it grows in multiples of 64 KB
+    EXPECT_EQ(mem_pool_reserve(&pool, 100), 0);
+    EXPECT_EQ(pool.size, 0x1'0000);
+    std::fill_n(pool.pbase, pool.size, 'a');
+    EXPECT_EQ(mem_pool_reserve(&pool, 0x10'0000), 0);
+    EXPECT_EQ(pool.size, 0x10'0000);
+    EXPECT_EQ(pool.pbase, pbase);
+    std::fill_n(pool.pbase + 0x1'0000, pool.size - 0x1'0000, 'b');
+    EXPECT_EQ(std::count(pool.pbase, pool.pbase + 0x1'0000, 'a'), 0x1'0000);
+
+    // less space does not change it
+    EXPECT_EQ(mem_pool_reserve(&pool, 0x100), 0);
+    EXPECT_EQ(pool.size, 0x10'0000);
+
+    EXPECT_EQ(mem_pool_map(&pool, 0x10'0000, 0), 1); // already mapped
+    EXPECT_EQ(mem_pool_unmap(&pool), 0);
+    EXPECT_EQ(pool.pbase, nullptr);
+    EXPECT_EQ(pool.size, 0);
+    EXPECT_EQ(pool.capacity, 0);
+    EXPECT_EQ(pool.flags, 0);
+    EXPECT_EQ(mem_pool_unmap(&pool), 0); // idempotent
+    EXPECT_EQ(mem_pool_reserve(&pool, 0x100), 1);
+}
+
+TEST(MemoryPoolTest, pools_coexist) {
+    mem_pool pool1 = {};
+    mem_pool pool2 = {};
+    ASSERT_EQ(mem_pool_map(&pool1, 0x40'0000, 0), 0);
+    ASSERT_EQ(mem_pool_map(&pool2, 0x40'0000, MEM_HUGEPAGES), 0);
+    EXPECT_EQ(pool2.flags, MEM_MMAP | MEM_HUGEPAGES);
+    ASSERT_EQ(mem_pool_reserve(&pool1, 0x40'0000), 0);
+    ASSERT_EQ(mem_pool_reserve(&pool2, 0x40'0000), 0);
+    EXPECT_TRUE(pool1.pbase + pool1.capacity <= pool2.pbase
+                || pool2.pbase + pool2.capacity <= pool1.pbase);
+    std::fill_n(pool1.pbase, pool1.size, '1');
+    std::fill_n(pool2.pbase, pool2.size, '2');
+    EXPECT_EQ(std::count(pool1.pbase, pool1.pbase + pool1.size, '1'), int64_t(pool1.size));
+    EXPECT_EQ(std::count(pool2.pbase, pool2.pbase + pool2.size, '2'), int64_t(pool2.size));
+    EXPECT_EQ(mem_pool_unmap(&pool1), 0);
+    EXPECT_EQ(mem_pool_unmap(&pool2), 0);
+}
+
+TEST(MemoryPoolTest, reserve_above_capacity_grows_in_place_or_fails) {
+    mem_pool pool = {};
+    ASSERT_EQ(mem_pool_map(&pool, 0x1'0000, 0), 0);
+    ASSERT_EQ(mem_pool_reserve(&pool, 0x1'0000), 0);
+    const auto pbase = pool.pbase;
+    std::fill_n(pool.pbase, pool.size, 'a');
+    if (mem_pool_reserve(&pool, 0x4'0000) == 0) {
+        EXPECT_EQ(pool.size, 0x4'0000);
+        EXPECT_EQ(pool.capacity, 0x4'0000);
+        std::fill_n(pool.pbase + 0x1'0000, 0x3'0000, 'b');
+    } else {
+        // the addresses after the pool are in use: it never moves
+        EXPECT_EQ(pool.size, 0x1'0000);
+        EXPECT_EQ(pool.capacity, 0x1'0000);
+    }
+    EXPECT_EQ(pool.pbase, pbase);
+    EXPECT_EQ(std::count(pool.pbase, pool.pbase + 0x1'0000, 'a'), 0x1'0000);
+    EXPECT_EQ(mem_pool_unmap(&pool), 0);
+}
+
+TEST(MemoryPoolTest, reserve_above_capacity_partly_accessible) {
+    mem_pool pool = Utils::MapPoolWithRoomAfter(0x4'0000, 0x4'0000);
+    ASSERT_NE(pool.pbase, nullptr);
+    const auto pbase = pool.pbase;
+    // the pool is an accessible part and an inaccessible one
+    ASSERT_EQ(mem_pool_reserve(&pool, 0x1'0000), 0);
+    std::fill_n(pool.pbase, pool.size, 'a');
+
+    EXPECT_EQ(mem_pool_reserve(&pool, 0x6'0000), 0);
+    EXPECT_EQ(pool.pbase, pbase);
+    EXPECT_EQ(pool.size, 0x6'0000);
+    EXPECT_EQ(pool.capacity, 0x6'0000);
+    std::fill_n(pool.pbase + 0x1'0000, 0x5'0000, 'b');
+    EXPECT_EQ(std::count(pool.pbase, pool.pbase + 0x1'0000, 'a'), 0x1'0000);
+
+    // it grows again from its new capacity up to the addresses in use
+    ASSERT_EQ(mem_pool_release(&pool, 0x2'0000), 0);
+    EXPECT_EQ(mem_pool_reserve(&pool, 0x8'0000), 0);
+    EXPECT_EQ(pool.capacity, 0x8'0000);
+    std::fill_n(pool.pbase + 0x2'0000, 0x6'0000, 'c');
+    auto blocker = mmap(pool.pbase + pool.capacity,
+          0x1'0000,
+          PROT_NONE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE,
+          -1,
+          0);
+    ASSERT_EQ(blocker, pool.pbase + pool.capacity);
+    EXPECT_EQ(mem_pool_reserve(&pool, 0x9'0000), 1);
+    EXPECT_EQ(pool.size, 0x8'0000);
+    EXPECT_EQ(pool.capacity, 0x8'0000);
+    EXPECT_EQ(std::count(pool.pbase, pool.pbase + 0x1'0000, 'a'), 0x1'0000);
+
+    EXPECT_EQ(mem_pool_unmap(&pool), 0);
+    EXPECT_EQ(munmap(blocker, 0x1'0000), 0);
+}
+
+TEST(MemoryPoolTest, grow_to) {
+    mem_pool pool = {};
+    ASSERT_EQ(mem_pool_map(&pool, 0x10'0000, 0), 0);
+    uint64_t top = 0;
+    auto ptr = static_cast<uint8_t*>(mem_pool_grow_to(&pool, 0x100, 0x2000, &top));
+    EXPECT_EQ(ptr, pool.pbase + 0x100);
+    EXPECT_EQ(top, 0x2000);
+    EXPECT_GE(pool.size, 0x2000);
+    std::fill_n(ptr, 0x1f00, 'a');
+
+    // beyond the addresses reserved: the top does not change
+    EXPECT_EQ(mem_pool_grow_to(&pool, 0x2000, 0x8000'0000'0000, &top), nullptr);
+    EXPECT_EQ(top, 0x2000);
+
+    EXPECT_EQ(mem_pool_unmap(&pool), 0);
+}
+
+TEST(MemoryPoolTest, release_and_discard) {
+    mem_pool pool = {};
+    ASSERT_EQ(mem_pool_map(&pool, 0x10'0000, 0), 0);
+    ASSERT_EQ(mem_pool_reserve(&pool, 0x10'0000), 0);
+    std::fill_n(pool.pbase, pool.size, 'a');
+
+    // only the pages entirely in the range read as 0
+    EXPECT_EQ(mem_pool_discard(&pool, 0x8000, 0x2'0000), 0);
+    EXPECT_EQ(std::count(pool.pbase, pool.pbase + 0x1'0000, 'a'), 0x1'0000);
+    EXPECT_EQ(std::count(pool.pbase + 0x1'0000, pool.pbase + 0x2'0000, 0), 0x1'0000);
+    EXPECT_EQ(std::count(pool.pbase + 0x2'0000, pool.pbase + pool.size, 'a'), 0xe'0000);
+    EXPECT_EQ(mem_pool_discard(&pool, 0x3'0008, 0x1'0000), 0); // no whole page
+    EXPECT_EQ(std::count(pool.pbase + 0x2'0000, pool.pbase + pool.size, 'a'), 0xe'0000);
+
+    // the pool shrinks to whole pages and grows again
+    EXPECT_EQ(mem_pool_release(&pool, 0x4'0001), 0);
+    EXPECT_EQ(pool.size, 0x5'0000);
+    EXPECT_EQ(std::count(pool.pbase + 0x2'0000, pool.pbase + pool.size, 'a'), 0x3'0000);
+    EXPECT_EQ(mem_pool_release(&pool, 0x10'0000), 0); // more than it has
+    EXPECT_EQ(pool.size, 0x5'0000);
+    EXPECT_EQ(mem_pool_reserve(&pool, 0x10'0000), 0);
+    EXPECT_EQ(std::count(pool.pbase + 0x5'0000, pool.pbase + pool.size, 0), 0xb'0000);
+    EXPECT_EQ(mem_pool_unmap(&pool), 0);
+    EXPECT_EQ(mem_pool_release(&pool, 0), 1);
+    EXPECT_EQ(mem_pool_discard(&pool, 0, 0x1'0000), 1);
+}
+
 }
 }
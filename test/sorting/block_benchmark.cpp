@@ -0,0 +1,67 @@
+#include "sorting/block.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+// from 1e3 to 1e8 elements in random order (the copy of the original values is part of the time)
+constexpr int64_t MIN_ELEMENTS = 1'000;
+constexpr int64_t MAX_ELEMENTS = 100'000'000;
+
+std::vector<uint64_t> randomVector(size_t size) {
+    std::vector<uint64_t> values(size, 0);
+    std::iota(values.begin(), values.end(), 0);
+
+    std::mt19937 g(7);
+    std::shuffle(values.begin(), values.end(), g);
+    return values;
+}
+
+void BM_BlockQuickSort(benchmark::State& state) {
+    const auto original = randomVector(state.range(0));
+    auto values = original;
+    for (auto _ : state) {
+        values = original;
+        _block_quick_sort(values.data(), values.data() + values.size(), _ninther_pivot);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_HoareQuickSort(benchmark::State& state) {
+    const auto original = randomVector(state.range(0));
+    auto values = original;
+    for (auto _ : state) {
+        values = original;
+        _quick_sort(values.data(), values.data() + values.size(), _ninther_pivot);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_StdSort(benchmark::State& state) {
+    const auto original = randomVector(state.range(0));
+    auto values = original;
+    for (auto _ : state) {
+        values = original;
+        std::sort(values.begin(), values.end());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_BlockQuickSort)
+      ->RangeMultiplier(10)
+      ->Range(MIN_ELEMENTS, MAX_ELEMENTS)
+      ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_HoareQuickSort)
+      ->RangeMultiplier(10)
+      ->Range(MIN_ELEMENTS, MAX_ELEMENTS)
+      ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_StdSort)
+      ->RangeMultiplier(10)
+      ->Range(MIN_ELEMENTS, MAX_ELEMENTS)
+      ->Unit(benchmark::kMillisecond);
+} // namespace
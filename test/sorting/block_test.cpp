@@ -0,0 +1,121 @@
+#include "sorting/block.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t NUM_ELEMENTS = 100'000;
+pivot_f pivot_function = _ninther_pivot;
+
+TEST(blockTest, random) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::iota(values.begin(), values.end(), 0);
+    const auto verify = values; // sorted
+
+    std::random_device rd;
+    std::mt19937 g(rd());
+    std::shuffle(values.begin(), values.end(), g);
+
+    EXPECT_NE(verify, values);
+
+    _block_quick_sort(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(blockTest, ordered) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::iota(values.begin(), values.end(), 0);
+    const auto verify = values; // sorted
+
+    _block_quick_sort(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(blockTest, inverted) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::iota(values.rbegin(), values.rend(), 0); // inverted
+    auto verify = values;
+    std::iota(verify.begin(), verify.end(), 0); // sorted
+
+    EXPECT_NE(verify, values);
+
+    _block_quick_sort(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(blockTest, constant) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 7);
+    const auto verify = values;
+
+    _block_quick_sort(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(blockTest, few_unique) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::mt19937 g(7);
+    for (auto& value : values) {
+        value = g() % 16;
+    }
+    auto verify = values;
+    std::sort(verify.begin(), verify.end());
+
+    _block_quick_sort(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+// the sizes around the block and insertion sort limits with every pivot
+TEST(blockTest, small) {
+    std::mt19937 g(7);
+    const pivot_f pivots[] = {
+        _left_pivot,        _right_pivot,           _middle_pivot,  _random_pivot,
+        _semi_random_pivot, _median_of_three_pivot, _ninther_pivot,
+    };
+    for (auto pivot : pivots) {
+        for (size_t size = 0; size < 300; ++size) {
+            SCOPED_TRACE("size = " + std::to_string(size));
+            std::vector<uint64_t> values(size, 0);
+            for (auto& value : values) {
+                value = g() % 100;
+            }
+            auto verify = values;
+            std::sort(verify.begin(), verify.end());
+
+            _block_quick_sort(values.data(), values.data() + values.size(), pivot);
+
+            EXPECT_EQ(verify, values);
+        }
+    }
+}
+
+TEST(blockTest, partition) {
+    std::vector<uint64_t> values(1'000, 0);
+    std::mt19937 g(7);
+    for (auto& value : values) {
+        value = g() % 100;
+    }
+    auto* pivot = &values[values.size() / 3];
+    const auto pivot_value = *pivot;
+
+    auto* p = _block_partition(values.data(), values.data() + values.size(), pivot);
+
+    EXPECT_EQ(*p, pivot_value);
+    for (auto* it = values.data(); it != p; ++it) {
+        EXPECT_LE(*it, pivot_value);
+    }
+    for (auto* it = p; it != values.data() + values.size(); ++it) {
+        EXPECT_GE(*it, pivot_value);
+    }
+}
+} // namespace
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <numeric>
 #include <random>
+#include <string>
 #include <vector>
 
 namespace {
@@ -37,118 +38,106 @@ std::vector<uint64_t> constantVector() {
     return std::vector<uint64_t>(NUM_ELEMENTS, 7);
 }
 
-typedef std::vector<uint64_t> (*vector_f)();
+// many duplicates: 16 different values in random order
+std::vector<uint64_t> fewUniqueVector() {
+    auto values = randomVector();
+    for (auto& value : values) {
+        value %= 16;
+    }
+    return values;
+}
 
-void BenchmarkQuickSort(benchmark::State& state, vector_f vectorF, pivot_f pivotF) {
+typedef std::vector<uint64_t> (*vector_f)();
+typedef void (*pivot_sort_f)(uint64_t* begin, uint64_t* end, pivot_f pivot);
+
+struct Input {
+    const char* name;
+    vector_f vector;
+};
+
+// a pivot and the quick sort specialized for it
+struct Pivot {
+    const char* name;
+    pivot_f pivot;
+    sort_f specialized;
+};
+
+struct Sort {
+    const char* name;
+    pivot_sort_f sort;
+};
+
+const Input INPUTS[] = {
+    { "RandomValues", randomVector },
+    { "SortedValues", sortedVector },
+    { "InvertedValues", invertedVector },
+    { "ConstantValues", constantVector },
+    { "FewUniqueValues", fewUniqueVector },
+};
+
+const Pivot PIVOTS[] = {
+    { "LeftPivot", _left_pivot, _quick_sort_left },
+    { "RightPivot", _right_pivot, _quick_sort_right },
+    { "MiddlePivot", _middle_pivot, _quick_sort_middle },
+    { "RandomPivot", _random_pivot, _quick_sort_random },
+    { "SemiRandomPivot", _semi_random_pivot, _quick_sort_semi_random },
+    { "MedianOfThreePivot", _median_of_three_pivot, _quick_sort_median_of_three },
+    { "NintherPivot", _ninther_pivot, _quick_sort_ninther },
+};
+
+const Sort SORTS[] = {
+    { "QuickSort", _quick_sort },
+    { "IntroSort", _intro_sort },
+    { "QuickSortThreeWay", _quick_sort_three_way },
+};
+
+void BenchmarkSort(benchmark::State& state, vector_f vectorF, pivot_sort_f sortF, pivot_f pivotF) {
     const auto original = vectorF();
     auto values = original;
     for (auto _ : state) {
         values = original;
-        _quick_sort(values.data(), values.data() + values.size(), pivotF);
+        sortF(values.data(), values.data() + values.size(), pivotF);
     }
 }
 
-void BM_QuickSort_RandomValues_LeftPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, randomVector, _left_pivot);
-}
-
-void BM_QuickSort_RandomValues_RightPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, randomVector, _right_pivot);
-}
-
-void BM_QuickSort_RandomValues_MiddlePivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, randomVector, _middle_pivot);
-}
-
-void BM_QuickSort_RandomValues_RandomPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, randomVector, _random_pivot);
-}
-
-void BM_QuickSort_RandomValues_SemiRandomPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, randomVector, _semi_random_pivot);
-}
-
-BENCHMARK(BM_QuickSort_RandomValues_LeftPivot);
-BENCHMARK(BM_QuickSort_RandomValues_RightPivot);
-BENCHMARK(BM_QuickSort_RandomValues_MiddlePivot);
-BENCHMARK(BM_QuickSort_RandomValues_RandomPivot);
-BENCHMARK(BM_QuickSort_RandomValues_SemiRandomPivot);
-
-void BM_QuickSort_SortedValues_LeftPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, sortedVector, _left_pivot);
-}
-
-void BM_QuickSort_SortedValues_RightPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, sortedVector, _right_pivot);
-}
-
-void BM_QuickSort_SortedValues_MiddlePivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, sortedVector, _middle_pivot);
-}
-
-void BM_QuickSort_SortedValues_RandomPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, sortedVector, _random_pivot);
-}
-
-void BM_QuickSort_SortedValues_SemiRandomPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, sortedVector, _semi_random_pivot);
-}
-
-BENCHMARK(BM_QuickSort_SortedValues_LeftPivot);
-BENCHMARK(BM_QuickSort_SortedValues_RightPivot);
-BENCHMARK(BM_QuickSort_SortedValues_MiddlePivot);
-BENCHMARK(BM_QuickSort_SortedValues_RandomPivot);
-BENCHMARK(BM_QuickSort_SortedValues_SemiRandomPivot);
-
-void BM_QuickSort_InvertedValues_LeftPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, invertedVector, _left_pivot);
-}
-
-void BM_QuickSort_InvertedValues_RightPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, invertedVector, _right_pivot);
-}
-
-void BM_QuickSort_InvertedValues_MiddlePivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, invertedVector, _middle_pivot);
-}
-
-void BM_QuickSort_InvertedValues_RandomPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, invertedVector, _random_pivot);
-}
-
-void BM_QuickSort_InvertedValues_SemiRandomPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, invertedVector, _semi_random_pivot);
-}
-
-BENCHMARK(BM_QuickSort_InvertedValues_LeftPivot);
-BENCHMARK(BM_QuickSort_InvertedValues_RightPivot);
-BENCHMARK(BM_QuickSort_InvertedValues_MiddlePivot);
-BENCHMARK(BM_QuickSort_InvertedValues_RandomPivot);
-BENCHMARK(BM_QuickSort_InvertedValues_SemiRandomPivot);
-
-void BM_QuickSort_ConstantValues_LeftPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, constantVector, _left_pivot);
-}
-
-void BM_QuickSort_ConstantValues_RightPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, constantVector, _right_pivot);
+void BenchmarkSpecializedQuickSort(benchmark::State& state, vector_f vectorF, sort_f sortF) {
+    const auto original = vectorF();
+    auto values = original;
+    for (auto _ : state) {
+        values = original;
+        sortF(values.data(), values.data() + values.size());
+    }
 }
 
-void BM_QuickSort_ConstantValues_MiddlePivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, constantVector, _middle_pivot);
+std::string BenchmarkName(const char* sort, const Input& input, const Pivot& pivot) {
+    return std::string("BM_") + sort + "_" + input.name + "_" + pivot.name;
 }
 
-void BM_QuickSort_ConstantValues_RandomPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, constantVector, _random_pivot);
+// BM_<sort>_<input>_<pivot> for every sort, input and pivot
+bool RegisterBenchmarks() {
+    for (const auto& sort : SORTS) {
+        for (const auto& input : INPUTS) {
+            for (const auto& pivot : PIVOTS) {
+                benchmark::RegisterBenchmark(BenchmarkName(sort.name, input, pivot).c_str(),
+                      BenchmarkSort,
+                      input.vector,
+                      sort.sort,
+                      pivot.pivot);
+            }
+        }
+    }
+    for (const auto& input : INPUTS) {
+        for (const auto& pivot : PIVOTS) {
+            benchmark::RegisterBenchmark(
+                  BenchmarkName("QuickSortSpecialized", input, pivot).c_str(),
+                  BenchmarkSpecializedQuickSort,
+                  input.vector,
+                  pivot.specialized);
+        }
+    }
+    return true;
 }
 
-void BM_QuickSort_ConstantValues_SemiRandomPivot(benchmark::State& state) {
-    BenchmarkQuickSort(state, constantVector, _semi_random_pivot);
-}
+[[maybe_unused]] const bool REGISTERED = RegisterBenchmarks();
 
-BENCHMARK(BM_QuickSort_ConstantValues_LeftPivot);
-BENCHMARK(BM_QuickSort_ConstantValues_RightPivot);
-BENCHMARK(BM_QuickSort_ConstantValues_MiddlePivot);
-BENCHMARK(BM_QuickSort_ConstantValues_RandomPivot);
-BENCHMARK(BM_QuickSort_ConstantValues_SemiRandomPivot);
 } // namespace
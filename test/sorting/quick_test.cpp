@@ -5,12 +5,17 @@
 #include <algorithm>
 #include <numeric>
 #include <random>
+#include <string>
 #include <vector>
 
 namespace {
 
 constexpr size_t NUM_ELEMENTS = 100'000;
 pivot_f pivot_function = _random_pivot;
+const sort_f specialized_sorts[] = {
+    _quick_sort_left,        _quick_sort_right,           _quick_sort_middle,  _quick_sort_random,
+    _quick_sort_semi_random, _quick_sort_median_of_three, _quick_sort_ninther,
+};
 
 TEST(quickTest, random) {
     std::vector<uint64_t> values(NUM_ELEMENTS, 0);
@@ -59,4 +64,294 @@ TEST(quickTest, constant) {
 
     EXPECT_EQ(verify, values);
 }
+
+TEST(quickTest, median_of_three_pivot) {
+    std::vector<uint64_t> values = { 5, 9, 1, 7, 3, 8, 2 };
+    // first 5, middle 7 and 1 before last 8
+    EXPECT_EQ(_median_of_three_pivot(values.data(), values.data() + values.size()), &values[3]);
+    // first 1, middle 3 and 1 before last 8
+    EXPECT_EQ(_median_of_three_pivot(values.data() + 2, values.data() + 7), &values[4]);
+    // a single element
+    EXPECT_EQ(_median_of_three_pivot(values.data(), values.data() + 1), &values[0]);
+}
+
+TEST(quickTest, small_pivots) {
+    std::mt19937 g(7);
+    const pivot_f pivots[] = { _median_of_three_pivot, _ninther_pivot };
+    for (auto pivot : pivots) {
+        for (size_t size = 1; size < 2 * 128; ++size) {
+            SCOPED_TRACE("size = " + std::to_string(size));
+            std::vector<uint64_t> values(size, 0);
+            for (auto& value : values) {
+                value = g() % 100;
+            }
+            const auto* begin = values.data();
+            const auto* p = pivot(values.data(), values.data() + values.size());
+
+            EXPECT_GE(p, begin);
+            EXPECT_LT(p, begin + std::max<size_t>(size - 1, 1)); // never the last
+        }
+    }
+}
+
+TEST(quickTest, ninther_pivot) {
+    // the medians of the groups are 1, 2 and 3
+    std::vector<uint64_t> values(128, 0);
+    const size_t eighth = values.size() / 8;
+    const size_t middle = (values.size() - 1) / 2;
+    const size_t last = values.size() - 2;
+    values[0] = 1;
+    values[eighth] = 1;
+    values[2 * eighth] = 9;
+    values[middle - eighth] = 2;
+    values[middle] = 0;
+    values[middle + eighth] = 2;
+    values[last - 2 * eighth] = 3;
+    values[last - eighth] = 9;
+    values[last] = 3;
+
+    const auto* p = _ninther_pivot(values.data(), values.data() + values.size());
+
+    EXPECT_EQ(*p, 2u);
+}
+
+TEST(introTest, random) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::iota(values.begin(), values.end(), 0);
+    const auto verify = values; // sorted
+
+    std::random_device rd;
+    std::mt19937 g(rd());
+    std::shuffle(values.begin(), values.end(), g);
+
+    EXPECT_NE(verify, values);
+
+    _intro_sort(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(introTest, inverted) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::iota(values.rbegin(), values.rend(), 0); // inverted
+    auto verify = values;
+    std::iota(verify.begin(), verify.end(), 0); // sorted
+
+    EXPECT_NE(verify, values);
+
+    _intro_sort(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(introTest, constant) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 7);
+    const auto verify = values;
+
+    _intro_sort(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+// the worst case of the left pivot: quick sort would go n levels deep, heap sort takes over
+TEST(introTest, ordered_left_pivot) {
+    std::vector<uint64_t> values(10 * NUM_ELEMENTS, 0);
+    std::iota(values.begin(), values.end(), 0);
+    const auto verify = values; // sorted
+
+    _intro_sort(values.data(), values.data() + values.size(), _left_pivot);
+
+    EXPECT_EQ(verify, values);
+
+    std::iota(values.rbegin(), values.rend(), 0); // inverted
+    _intro_sort(values.data(), values.data() + values.size(), _left_pivot);
+
+    EXPECT_EQ(verify, values);
+}
+
+// the sizes around the insertion sort cutoff with every pivot
+TEST(introTest, small) {
+    std::mt19937 g(7);
+    const pivot_f pivots[] = {
+        _left_pivot,        _right_pivot,           _middle_pivot,  _random_pivot,
+        _semi_random_pivot, _median_of_three_pivot, _ninther_pivot,
+    };
+    for (auto pivot : pivots) {
+        for (size_t size = 0; size < 40; ++size) {
+            SCOPED_TRACE("size = " + std::to_string(size));
+            std::vector<uint64_t> values(size, 0);
+            for (auto& value : values) {
+                value = g() % 10;
+            }
+            auto verify = values;
+            std::sort(verify.begin(), verify.end());
+
+            _intro_sort(values.data(), values.data() + values.size(), pivot);
+
+            EXPECT_EQ(verify, values);
+        }
+    }
+}
+
+TEST(threeWayTest, random) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::iota(values.begin(), values.end(), 0);
+    const auto verify = values; // sorted
+
+    std::random_device rd;
+    std::mt19937 g(rd());
+    std::shuffle(values.begin(), values.end(), g);
+
+    EXPECT_NE(verify, values);
+
+    _quick_sort_three_way(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(threeWayTest, ordered) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::iota(values.begin(), values.end(), 0);
+    const auto verify = values; // sorted
+
+    _quick_sort_three_way(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(threeWayTest, inverted) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::iota(values.rbegin(), values.rend(), 0); // inverted
+    auto verify = values;
+    std::iota(verify.begin(), verify.end(), 0); // sorted
+
+    EXPECT_NE(verify, values);
+
+    _quick_sort_three_way(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(threeWayTest, constant) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 7);
+    const auto verify = values;
+
+    _quick_sort_three_way(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(threeWayTest, few_unique) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::mt19937 g(7);
+    for (auto& value : values) {
+        value = g() % 16;
+    }
+    auto verify = values;
+    std::sort(verify.begin(), verify.end());
+
+    _quick_sort_three_way(values.data(), values.data() + values.size(), pivot_function);
+
+    EXPECT_EQ(verify, values);
+}
+
+TEST(threeWayTest, small) {
+    std::mt19937 g(7);
+    const pivot_f pivots[] = {
+        _left_pivot,        _right_pivot,           _middle_pivot,  _random_pivot,
+        _semi_random_pivot, _median_of_three_pivot, _ninther_pivot,
+    };
+    for (auto pivot : pivots) {
+        for (size_t size = 0; size < 40; ++size) {
+            SCOPED_TRACE("size = " + std::to_string(size));
+            std::vector<uint64_t> values(size, 0);
+            for (auto& value : values) {
+                value = g() % 10;
+            }
+            auto verify = values;
+            std::sort(verify.begin(), verify.end());
+
+            _quick_sort_three_way(values.data(), values.data() + values.size(), pivot);
+
+            EXPECT_EQ(verify, values);
+        }
+    }
+}
+
+TEST(specializedTest, random) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 0);
+    std::iota(values.begin(), values.end(), 0);
+    const auto verify = values; // sorted
+
+    std::random_device rd;
+    std::mt19937 g(rd());
+    for (auto sort : specialized_sorts) {
+        std::shuffle(values.begin(), values.end(), g);
+
+        EXPECT_NE(verify, values);
+
+        sort(values.data(), values.data() + values.size());
+
+        EXPECT_EQ(verify, values);
+    }
+}
+
+TEST(specializedTest, ordered) {
+    // the left pivot takes n partitions (quadratic time) on sorted values
+    std::vector<uint64_t> values(NUM_ELEMENTS / 10, 0);
+    std::iota(values.begin(), values.end(), 0);
+    const auto verify = values; // sorted
+
+    for (auto sort : specialized_sorts) {
+        sort(values.data(), values.data() + values.size());
+
+        EXPECT_EQ(verify, values);
+    }
+}
+
+TEST(specializedTest, inverted) {
+    std::vector<uint64_t> values(NUM_ELEMENTS / 10, 0);
+    auto verify = values;
+    std::iota(verify.begin(), verify.end(), 0); // sorted
+
+    for (auto sort : specialized_sorts) {
+        std::iota(values.rbegin(), values.rend(), 0); // inverted
+
+        EXPECT_NE(verify, values);
+
+        sort(values.data(), values.data() + values.size());
+
+        EXPECT_EQ(verify, values);
+    }
+}
+
+TEST(specializedTest, constant) {
+    std::vector<uint64_t> values(NUM_ELEMENTS, 7);
+    const auto verify = values;
+
+    for (auto sort : specialized_sorts) {
+        sort(values.data(), values.data() + values.size());
+
+        EXPECT_EQ(verify, values);
+    }
+}
+
+TEST(specializedTest, small) {
+    std::mt19937 g(7);
+    for (auto sort : specialized_sorts) {
+        for (size_t size = 0; size < 40; ++size) {
+            SCOPED_TRACE("size = " + std::to_string(size));
+            std::vector<uint64_t> values(size, 0);
+            for (auto& value : values) {
+                value = g() % 10;
+            }
+            auto verify = values;
+            std::sort(verify.begin(), verify.end());
+
+            sort(values.data(), values.data() + values.size());
+
+            EXPECT_EQ(verify, values);
+        }
+    }
+}
 } // namespace
@@ -0,0 +1,108 @@
+// records the malloc/free of a program into a trace: LD_PRELOAD=libmtrace_preload.so (the trace
+// goes to $MTRACE_FILE or to mtrace.bin)
+#include "mtrace/trace.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// the allocator of glibc (the preloaded functions replace the public names only)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+namespace {
+// the recorder allocates too: its own blocks are not recorded
+__attribute__((tls_model("initial-exec"))) thread_local bool in_recorder = false;
+
+alignas(mtrace::TraceRecorder) unsigned char recorder_storage[sizeof(mtrace::TraceRecorder)];
+mtrace::TraceRecorder* recorder = nullptr;
+bool done = false;
+
+// the recorder to use (nullptr while it is being set up or after the program ends)
+mtrace::TraceRecorder* Recorder() {
+    if (recorder == nullptr && !done) {
+        const char* path = std::getenv("MTRACE_FILE");
+        recorder = new (recorder_storage) mtrace::TraceRecorder(path ? path : "mtrace.bin");
+    }
+    return recorder;
+}
+
+class Guard {
+public:
+    Guard()
+          : active_(!in_recorder) {
+        in_recorder = true;
+    }
+    ~Guard() {
+        if (active_) {
+            in_recorder = false;
+        }
+    }
+    bool Active() const { return active_; }
+
+private:
+    bool active_;
+};
+
+__attribute__((destructor)) void Finish() {
+    in_recorder = true;
+    if (recorder != nullptr) {
+        recorder->~TraceRecorder();
+        recorder = nullptr;
+    }
+    done = true;
+}
+}
+
+extern "C" {
+void* malloc(size_t size) {
+    void* ptr = __libc_malloc(size);
+    Guard guard;
+    if (guard.Active() && Recorder() != nullptr) {
+        recorder->Allocated(ptr, size);
+    }
+    return ptr;
+}
+
+void* calloc(size_t num, size_t size) {
+    void* ptr = __libc_calloc(num, size);
+    Guard guard;
+    if (guard.Active() && Recorder() != nullptr) {
+        recorder->Allocated(ptr, num * size);
+    }
+    return ptr;
+}
+
+void* realloc(void* old_ptr, size_t size) {
+    void* ptr = __libc_realloc(old_ptr, size);
+    Guard guard;
+    if (guard.Active() && Recorder() != nullptr) {
+        if (old_ptr == nullptr) {
+            recorder->Allocated(ptr, size);
+        } else if (size == 0) {
+            recorder->Deallocated(old_ptr);
+        } else {
+            recorder->Reallocated(old_ptr, ptr, size);
+        }
+    }
+    return ptr;
+}
+
+void free(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    {
+        // recorded before it is freed: the address may be reused by another thread right after
+        Guard guard;
+        if (guard.Active() && Recorder() != nullptr) {
+            recorder->Deallocated(ptr);
+        }
+    }
+    __libc_free(ptr);
+}
+}
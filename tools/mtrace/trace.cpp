@@ -0,0 +1,243 @@
+#include "mtrace/trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace mtrace {
+namespace {
+void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool GetVarint(const std::vector<uint8_t>& in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        const uint8_t byte = in[pos++];
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PutHeader(std::vector<uint8_t>& out) {
+    out.insert(out.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    for (unsigned i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(VERSION >> (8 * i)));
+    }
+}
+}
+
+bool Event::operator==(const Event& other) const {
+    return time_ns == other.time_ns && kind == other.kind && slot == other.slot
+        && size == other.size;
+}
+
+void EncodeEvent(std::vector<uint8_t>& out, uint64_t delta_ns, const Event& event) {
+    PutVarint(out, delta_ns);
+    PutVarint(out, uint64_t(event.slot) << 2 | static_cast<uint64_t>(event.kind));
+    if (event.kind != EventKind::DEALLOCATE) {
+        PutVarint(out, event.size);
+    }
+}
+
+bool WriteTrace(const std::string& path, const Trace& trace) {
+    std::vector<uint8_t> out;
+    PutHeader(out);
+    uint64_t last_ns = 0;
+    for (const auto& event : trace.events) {
+        EncodeEvent(out, event.time_ns - last_ns, event);
+        last_ns = event.time_ns;
+    }
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool written = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    return std::fclose(file) == 0 && written;
+}
+
+bool ReadTrace(const std::string& path, Trace& trace) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    std::vector<uint8_t> in;
+    uint8_t chunk[1 << 16];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        in.insert(in.end(), chunk, chunk + n);
+    }
+    std::fclose(file);
+
+    if (in.size() < 8 || std::memcmp(in.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+    uint32_t version = 0;
+    for (unsigned i = 0; i < 4; ++i) {
+        version |= uint32_t(in[4 + i]) << (8 * i);
+    }
+    if (version != VERSION) {
+        return false;
+    }
+
+    trace = Trace();
+    uint64_t time_ns = 0;
+    for (size_t pos = 8; pos < in.size();) {
+        uint64_t delta_ns;
+        uint64_t slot_kind;
+        Event event{};
+        if (!GetVarint(in, pos, delta_ns) || !GetVarint(in, pos, slot_kind)) {
+            return false;
+        }
+        event.kind = static_cast<EventKind>(slot_kind & 3);
+        event.slot = static_cast<uint32_t>(slot_kind >> 2);
+        if (event.kind > EventKind::REALLOCATE) {
+            return false;
+        }
+        if (event.kind != EventKind::DEALLOCATE && !GetVarint(in, pos, event.size)) {
+            return false;
+        }
+        time_ns += delta_ns;
+        event.time_ns = time_ns;
+        trace.events.push_back(event);
+        trace.num_slots = std::max(trace.num_slots, event.slot + 1);
+    }
+    return true;
+}
+
+Trace SyntheticTrace(uint64_t num_events, uint32_t num_slots) {
+    Trace trace;
+    trace.num_slots = num_slots;
+    std::vector<bool> used(num_slots, false);
+    uint64_t seed = 7;
+    while (trace.events.size() < num_events) {
+        seed = seed * 6364136223846793005 + 1442695040888963407;
+        const auto slot = static_cast<uint32_t>((seed >> 33) % num_slots);
+        if (used[slot]) {
+            trace.events.push_back({ 0, EventKind::DEALLOCATE, slot, 0 });
+            used[slot] = false;
+            continue;
+        }
+        const uint64_t kind = (seed >> 20) % 64;
+        const uint64_t size = kind < 56 ? 16 + (seed >> 40) % 240
+                            : kind < 63 ? 1024 + (seed >> 40) % 7168
+                                        : 65536 + (seed >> 40) % 65536;
+        trace.events.push_back({ 0, EventKind::ALLOCATE, slot, size });
+        used[slot] = true;
+    }
+    return trace;
+}
+
+uint64_t PeakLiveBytes(const Trace& trace) {
+    std::vector<uint64_t> sizes(trace.num_slots, 0);
+    uint64_t live = 0;
+    uint64_t peak = 0;
+    for (const auto& event : trace.events) {
+        live -= sizes[event.slot];
+        sizes[event.slot] = event.size;
+        live += event.size;
+        peak = std::max(peak, live);
+    }
+    return peak;
+}
+
+TraceRecorder::TraceRecorder(const std::string& path)
+      : file_(std::fopen(path.c_str(), "wb")),
+        start_ns_(Now()) {
+    PutHeader(buffer_);
+}
+
+TraceRecorder::~TraceRecorder() {
+    Flush();
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+void TraceRecorder::Allocated(const void* ptr, uint64_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Record(EventKind::ALLOCATE, TakeSlot(ptr), size);
+}
+
+void TraceRecorder::Deallocated(const void* ptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t slot;
+    if (ReleaseSlot(ptr, slot)) {
+        Record(EventKind::DEALLOCATE, slot, 0);
+    }
+}
+
+void TraceRecorder::Reallocated(const void* old_ptr, const void* new_ptr, uint64_t size) {
+    if (new_ptr == nullptr) {
+        return; // the old block is still there
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = slots_.find(old_ptr);
+    if (it == slots_.end()) {
+        Record(EventKind::ALLOCATE, TakeSlot(new_ptr), size);
+        return;
+    }
+    // the block keeps its slot wherever it moves
+    const uint32_t slot = it->second;
+    slots_.erase(it);
+    slots_[new_ptr] = slot;
+    Record(EventKind::REALLOCATE, slot, size);
+}
+
+void TraceRecorder::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ != nullptr && !buffer_.empty()) {
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        std::fflush(file_);
+    }
+    buffer_.clear();
+}
+
+uint64_t TraceRecorder::Now() const {
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+void TraceRecorder::Record(EventKind kind, uint32_t slot, uint64_t size) {
+    const uint64_t now_ns = Now() - start_ns_;
+    EncodeEvent(buffer_, now_ns - last_ns_, { now_ns, kind, slot, size });
+    last_ns_ = now_ns;
+    if (buffer_.size() >= FLUSH_SZ && file_ != nullptr) {
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        buffer_.clear();
+    }
+}
+
+uint32_t TraceRecorder::TakeSlot(const void* ptr) {
+    uint32_t slot;
+    if (free_slots_.empty()) {
+        slot = num_slots_++;
+    } else {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    slots_[ptr] = slot;
+    return slot;
+}
+
+bool TraceRecorder::ReleaseSlot(const void* ptr, uint32_t& slot) {
+    const auto it = slots_.find(ptr);
+    if (it == slots_.end()) {
+        return false; // not recorded (e.g. allocated before recording started)
+    }
+    slot = it->second;
+    slots_.erase(it);
+    free_slots_.push_back(slot);
+    return true;
+}
+}
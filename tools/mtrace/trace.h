@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mtrace {
+// an allocation event: the blocks are identified by slots (a slot is reused after its block is
+// deallocated, so the slots of a trace are as many as the most blocks alive at once)
+enum class EventKind : uint8_t {
+    ALLOCATE = 0,
+    DEALLOCATE = 1,
+    REALLOCATE = 2,
+};
+
+struct Event {
+    uint64_t time_ns; // since the first event
+    EventKind kind;
+    uint32_t slot;
+    uint64_t size; // 0 for DEALLOCATE
+
+    bool operator==(const Event& other) const;
+};
+
+struct Trace {
+    std::vector<Event> events;
+    uint32_t num_slots = 0;
+};
+
+// binary trace: "MTRC", version (4 bytes, little endian) and the events, each as LEB128 varints
+// of the time since the previous event, slot << 2 | kind and (but for DEALLOCATE) size
+constexpr char MAGIC[4] = { 'M', 'T', 'R', 'C' };
+constexpr uint32_t VERSION = 1;
+
+// append an event to a binary trace being built (after the header, see WriteTrace)
+void EncodeEvent(std::vector<uint8_t>& out, uint64_t delta_ns, const Event& event);
+
+// write/read a whole trace (false if the file could not be written / is not a trace)
+bool WriteTrace(const std::string& path, const Trace& trace);
+bool ReadTrace(const std::string& path, Trace& trace);
+
+// a trace of mostly small blocks with some medium and a few big ones, that keeps about
+// num_slots / 2 blocks alive and frees them in random order (no timestamps)
+Trace SyntheticTrace(uint64_t num_events, uint32_t num_slots);
+
+// the most bytes alive at once while the trace is replayed
+uint64_t PeakLiveBytes(const Trace& trace);
+
+// records the events of an allocator as they happen into a binary trace file (thread safe)
+class TraceRecorder {
+public:
+    explicit TraceRecorder(const std::string& path);
+    ~TraceRecorder();
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    bool IsOpen() const { return file_ != nullptr; }
+
+    void Allocated(const void* ptr, uint64_t size);
+    void Deallocated(const void* ptr);
+    void Reallocated(const void* old_ptr, const void* new_ptr, uint64_t size);
+    // write the buffered events to the file
+    void Flush();
+
+private:
+    static constexpr size_t FLUSH_SZ = 1 << 20;
+
+    uint64_t Now() const;
+    void Record(EventKind kind, uint32_t slot, uint64_t size);
+    uint32_t TakeSlot(const void* ptr);
+    bool ReleaseSlot(const void* ptr, uint32_t& slot);
+
+    std::mutex mutex_;
+    std::FILE* file_;
+    std::vector<uint8_t> buffer_;
+    std::unordered_map<const void*, uint32_t> slots_;
+    std::vector<uint32_t> free_slots_;
+    uint32_t num_slots_ = 0;
+    uint64_t start_ns_;
+    uint64_t last_ns_ = 0;
+};
+}